@@ -6,39 +6,169 @@
 
 #include "EmulNet.h"
 
+/**
+ * FUNCTION NAME: alloc
+ *
+ * DESCRIPTION: Returns a payload buffer of at least size bytes,
+ * 				reusing a released buffer of the same size class when possible
+ */
+char *MsgPool::alloc(int size) {
+	pool_hdr *hdr;
+	int cls = 0;
+	int need = size + (int)sizeof(pool_hdr);
+
+	while ( cls < POOL_CLASSES && (1 << (POOL_MIN_SHIFT + cls)) < need ) {
+		cls++;
+	}
+
+	if ( cls < POOL_CLASSES && !freelist[cls].empty() ) {
+		hdr = freelist[cls].back();
+		freelist[cls].pop_back();
+		hits++;
+	}
+	else {
+		if ( cls < POOL_CLASSES ) {
+			need = 1 << (POOL_MIN_SHIFT + cls);
+		}
+		hdr = (pool_hdr *) malloc(need);
+		hdr->sizeclass = cls;
+		misses++;
+	}
+	hdr->refs = 1;
+	return (char *)(hdr + 1);
+}
+
+/**
+ * FUNCTION NAME: retain
+ *
+ * DESCRIPTION: Adds count holders to a buffer obtained from alloc
+ */
+void MsgPool::retain(char *buff, int count) {
+	(((pool_hdr *)buff) - 1)->refs += count;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Drops one holder of a buffer obtained from alloc,
+ * 				giving it back to its free list once nobody holds it
+ */
+void MsgPool::release(char *buff) {
+	pool_hdr *hdr = ((pool_hdr *)buff) - 1;
+
+	if ( --hdr->refs > 0 ) {
+		return;
+	}
+
+	if ( hdr->sizeclass >= POOL_CLASSES ) {
+		free(hdr);
+		return;
+	}
+	freelist[hdr->sizeclass].push_back(hdr);
+}
+
+/**
+ * Destructor
+ */
+MsgPool::~MsgPool() {
+	for ( int cls = 0; cls < POOL_CLASSES; cls++ ) {
+		for ( size_t i = 0; i < freelist[cls].size(); i++ ) {
+			free(freelist[cls][i]);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: schedule
+ *
+ * DESCRIPTION: Holds msg in the wheel until msg.due
+ */
+void TimingWheel::schedule(en_msg &msg) {
+	slots[msg.due & (WHEEL_SLOTS - 1)].push_back(msg);
+	pending++;
+}
+
+/**
+ * FUNCTION NAME: expire
+ *
+ * DESCRIPTION: Moves every message due at or before time into its destination inbox
+ *
+ * RETURNS:
+ * number of messages released
+ */
+int TimingWheel::expire(int time, EM &emulnet) {
+	int released = 0;
+	int tick, last;
+	size_t i, kept;
+
+	if ( time <= lasttick || pending == 0 ) {
+		lasttick = max(lasttick, time);
+		return 0;
+	}
+	// Each slot needs to be visited at most once per call
+	last = min(time, lasttick + WHEEL_SLOTS);
+	for ( tick = lasttick + 1; tick <= last; tick++ ) {
+		vector<en_msg> &slot = slots[tick & (WHEEL_SLOTS - 1)];
+		kept = 0;
+		for ( i = 0; i < slot.size(); i++ ) {
+			if ( slot[i].due <= time ) {
+				emulnet.getInbox(&slot[i].to).push_back(slot[i]);
+				released++;
+			}
+			else {
+				slot[kept++] = slot[i];
+			}
+		}
+		slot.resize(kept);
+	}
+	lasttick = time;
+	pending -= released;
+	return released;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Empties the wheel, appending every held message to out
+ */
+void TimingWheel::clear(vector<en_msg> &out) {
+	for ( int i = 0; i < WHEEL_SLOTS; i++ ) {
+		out.insert(out.end(), slots[i].begin(), slots[i].end());
+		slots[i].clear();
+	}
+	pending = 0;
+}
+
 /**
  * Constructor
  */
 EmulNet::EmulNet(Params *p)
 {
 	//trace.funcEntry("EmulNet::EmulNet");
-	int i,j;
 	par = p;
 	emulnet.setNextId(1);
 	emulnet.settCurrBuffSize(0);
 	enInited=0;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			sent_msgs[i][j] = 0;
-			recv_msgs[i][j] = 0;
-		}
-	}
+	delayed_msgs = 0;
+	delay_total = 0;
 	//trace.funcExit("EmulNet::EmulNet", SUCCESS);
 }
 
 /**
  * Copy constructor
+ * The buffer pool is not shared, the copy starts with an empty one
  */
 EmulNet::EmulNet(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->buffdrop_msgs = anotherEmulNet.buffdrop_msgs;
+	this->randdrop_msgs = anotherEmulNet.randdrop_msgs;
+	this->sizedrop_msgs = anotherEmulNet.sizedrop_msgs;
+	this->wheel = anotherEmulNet.wheel;
+	this->delayed_msgs = anotherEmulNet.delayed_msgs;
+	this->delay_total = anotherEmulNet.delay_total;
 	this->emulnet = anotherEmulNet.emulnet;
 }
 
@@ -46,15 +176,16 @@ EmulNet::EmulNet(EmulNet &anotherEmulNet) {
  * Assignment operator overloading
  */
 EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->buffdrop_msgs = anotherEmulNet.buffdrop_msgs;
+	this->randdrop_msgs = anotherEmulNet.randdrop_msgs;
+	this->sizedrop_msgs = anotherEmulNet.sizedrop_msgs;
+	this->wheel = anotherEmulNet.wheel;
+	this->delayed_msgs = anotherEmulNet.delayed_msgs;
+	this->delay_total = anotherEmulNet.delay_total;
 	this->emulnet = anotherEmulNet.emulnet;
 	return *this;
 }
@@ -73,6 +204,7 @@ void *EmulNet::ENinit(Address *myaddr, short port) {
 	// Initialize data structures for this member
 	*(int *)(myaddr->addr) = emulnet.nextid++;
     *(short *)(&myaddr->addr[4]) = 0;
+	emulnet.getInbox(myaddr);
 	return myaddr;
 }
 
@@ -80,35 +212,87 @@ void *EmulNet::ENinit(Address *myaddr, short port) {
  * FUNCTION NAME: ENsend
  *
  * DESCRIPTION: EmulNet send function
+ * 				The caller keeps ownership of data, so the payload is copied once
  *
  * RETURNS:
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
-	en_msg *em;
+	char *payload = ENalloc(size);
+	memcpy(payload, data, size);
+	return this->ENsendOwned(myaddr, toaddr, payload, size);
+}
+
+/**
+ * FUNCTION NAME: ENsend
+ *
+ * DESCRIPTION: EmulNet send function
+ *
+ * RETURNS:
+ * size
+ */
+int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
+	char * str = ENalloc(data.length() * sizeof(char));
+	memcpy(str, data.c_str(), data.size());
+	return this->ENsendOwned(myaddr, toaddr, str, (data.length() * sizeof(char)));
+}
+
+/**
+ * FUNCTION NAME: ENsendOwned
+ *
+ * DESCRIPTION: EmulNet send function that takes ownership of a payload obtained from ENalloc.
+ * 				The same buffer is handed to the receiver's queue by ENrecv and
+ * 				must be given back with ENfree by the consumer once the message
+ * 				has been handled. If the message is dropped the buffer is freed here.
+ *
+ * RETURNS:
+ * size
+ */
+int EmulNet::ENsendOwned(Address *myaddr, Address *toaddr, char *data, int size) {
+	en_msg em;
 	static char temp[2048];
 	int sendmsg = rand() % 100;
+	int src = *(int *)(myaddr->addr);
 
-	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
+	// only the payload counts against the limit, not the bookkeeping around it
+	if( size >= par->MAX_MSG_SIZE ) {
+		countDrop(sizedrop_msgs, src);
+		ENfree(data);
+		return 0;
+	}
+	if( par->EN_BUFFSIZE > 0 && emulnet.currbuffsize >= par->EN_BUFFSIZE ) {
+		countDrop(buffdrop_msgs, src);
+		ENfree(data);
+		return 0;
+	}
+	if( par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100) ) {
+		countDrop(randdrop_msgs, src);
+		ENfree(data);
 		return 0;
 	}
 
-	em = (en_msg *)malloc(sizeof(en_msg) + size);
-	em->size = size;
-
-	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
-	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
-	memcpy(em + 1, data, size);
-
-	emulnet.buff[emulnet.currbuffsize++] = em;
+	em.size = size;
+	em.from = *myaddr;
+	em.to = *toaddr;
+	em.data = data;
 
-	int src = *(int *)(myaddr->addr);
 	int time = par->getcurrtime();
+	int delay = drawDelay();
+
+	if ( delay > 0 ) {
+		// Would normally be received on the next tick, hold it delay ticks longer
+		em.due = time + 1 + delay;
+		wheel.schedule(em);
+		delayed_msgs++;
+		delay_total += delay;
+	}
+	else {
+		em.due = time;
+		emulnet.getInbox(toaddr).push_back(em);
+	}
+	emulnet.currbuffsize++;
 
-	assert(src <= MAX_NODES);
-	assert(time < MAX_TIME);
-
-	sent_msgs[src][time]++;
+	countMsg(sent_msgs, src, time);
 
 	#ifdef DEBUGLOG
 		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
@@ -118,25 +302,49 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
 }
 
 /**
- * FUNCTION NAME: ENsend
+ * FUNCTION NAME: ENmulticast
  *
- * DESCRIPTION: EmulNet send function
+ * DESCRIPTION: Sends the same payload to every address in toaddrs
  *
  * RETURNS:
- * size
+ * number of destinations the message was queued for
  */
-int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
-	char * str = (char *) malloc(data.length() * sizeof(char));
+int EmulNet::ENmulticast(Address *myaddr, vector<Address> &toaddrs, string data) {
+	char * str = ENalloc(data.length() * sizeof(char));
 	memcpy(str, data.c_str(), data.size());
-	int ret = this->ENsend(myaddr, toaddr, str, (data.length() * sizeof(char)));
-	free(str);
-	return ret;
+	return this->ENmulticast(myaddr, toaddrs, str, (data.length() * sizeof(char)));
+}
+
+/**
+ * FUNCTION NAME: ENmulticast
+ *
+ * DESCRIPTION: Sends one payload obtained from ENalloc to every address in toaddrs.
+ * 				The payload is stored once and shared by all destinations, each of
+ * 				which holds a reference released by its ENfree, so receivers must
+ * 				treat it as read only. Takes ownership of data.
+ *
+ * RETURNS:
+ * number of destinations the message was queued for
+ */
+int EmulNet::ENmulticast(Address *myaddr, vector<Address> &toaddrs, char *data, int size) {
+	int queued = 0;
+
+	// One reference per destination, plus ours which is dropped at the end
+	pool.retain(data, (int)toaddrs.size());
+	for ( size_t i = 0; i < toaddrs.size(); i++ ) {
+		if ( ENsendOwned(myaddr, &toaddrs[i], data, size) > 0 ) {
+			queued++;
+		}
+	}
+	ENfree(data);
+	return queued;
 }
 
 /**
  * FUNCTION NAME: ENrecv
  *
  * DESCRIPTION: EmulNet receive function
+ * 				Payloads are handed to the queue without copying; the consumer releases them with ENfree
  *
  * RETURN:
  * 0
@@ -144,36 +352,118 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
 int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
 	// times is always assumed to be 1
 	int i;
-	char* tmp;
-	int sz;
-	en_msg *emsg;
 
-	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
-		emsg = emulnet.buff[i];
+	// Release the delayed messages that became due since the last call
+	wheel.expire(par->getcurrtime(), emulnet);
 
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
-			sz = emsg->size;
-			tmp = (char *) malloc(sz * sizeof(char));
-			memcpy(tmp, (char *)(emsg+1), sz);
+	vector<en_msg> &myinbox = emulnet.getInbox(myaddr);
 
-			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
-			emulnet.currbuffsize--;
+	// Newest first, the order in which the shared buffer used to be scanned
+	for( i = (int)myinbox.size() - 1; i >= 0; i-- ) {
+		emulnet.currbuffsize--;
 
-			(*enq)(queue, (char *)tmp, sz);
+		(*enq)(queue, myinbox[i].data, myinbox[i].size);
 
-			free(emsg);
+		int dst = *(int *)(myaddr->addr);
+		int time = par->getcurrtime();
 
-			int dst = *(int *)(myaddr->addr);
-			int time = par->getcurrtime();
+		countMsg(recv_msgs, dst, time);
+	}
+	myinbox.clear();
 
-			assert(dst <= MAX_NODES);
-			assert(time < MAX_TIME);
+	return 0;
+}
 
-			recv_msgs[dst][time]++;
-		}
+/**
+ * FUNCTION NAME: drawDelay
+ *
+ * DESCRIPTION: Draws the extra delivery delay of one message from the configured model
+ *
+ * RETURNS:
+ * delay in ticks, 0 for immediate delivery
+ */
+int EmulNet::drawDelay() {
+	double u;
+	int delay;
+
+	switch ( par->DELAY_MODEL ) {
+		case FIXED_DELAY:
+			return max(par->DELAY_MIN, 0);
+		case UNIFORM_DELAY:
+			if ( par->DELAY_MAX <= par->DELAY_MIN ) {
+				return max(par->DELAY_MIN, 0);
+			}
+			return max(par->DELAY_MIN + rand() % (par->DELAY_MAX - par->DELAY_MIN + 1), 0);
+		case PARETO_DELAY:
+			// Pareto with scale DELAY_MIN (at least one tick) and shape DELAY_ALPHA, capped at DELAY_MAX
+			u = (rand() + 1.0) / ((double)RAND_MAX + 1.0);
+			delay = (int)(max(par->DELAY_MIN, 1) * pow(u, -1.0 / par->DELAY_ALPHA));
+			if ( par->DELAY_MAX > 0 && delay > par->DELAY_MAX ) {
+				delay = par->DELAY_MAX;
+			}
+			return delay;
+		default:
+			return 0;
 	}
+}
 
-	return 0;
+/**
+ * FUNCTION NAME: ENalloc
+ *
+ * DESCRIPTION: Allocates a message payload from the buffer pool
+ */
+char *EmulNet::ENalloc(int size) {
+	return pool.alloc(size);
+}
+
+/**
+ * FUNCTION NAME: ENfree
+ *
+ * DESCRIPTION: Releases a payload obtained from ENalloc or ENrecv to the buffer pool
+ */
+void EmulNet::ENfree(char *buff) {
+	pool.release(buff);
+}
+
+/**
+ * FUNCTION NAME: countMsg
+ *
+ * DESCRIPTION: Increments the counter of node at time, growing the table as needed
+ */
+void EmulNet::countMsg(vector< vector<int> > &counts, int node, int time) {
+	assert(node >= 0 && time >= 0);
+	if ( (size_t)node >= counts.size() ) {
+		counts.resize(node + 1);
+	}
+	if ( (size_t)time >= counts[node].size() ) {
+		counts[node].resize(time + 1, 0);
+	}
+	counts[node][time]++;
+}
+
+/**
+ * FUNCTION NAME: getCount
+ *
+ * DESCRIPTION: Returns the counter of node at time, 0 if it was never incremented
+ */
+int EmulNet::getCount(vector< vector<int> > &counts, int node, int time) {
+	if ( (size_t)node >= counts.size() || (size_t)time >= counts[node].size() ) {
+		return 0;
+	}
+	return counts[node][time];
+}
+
+/**
+ * FUNCTION NAME: countDrop
+ *
+ * DESCRIPTION: Increments the drop total of node, growing the table as needed
+ */
+void EmulNet::countDrop(vector<int> &counts, int node) {
+	assert(node >= 0);
+	if ( (size_t)node >= counts.size() ) {
+		counts.resize(node + 1, 0);
+	}
+	counts[node]++;
 }
 
 /**
@@ -185,12 +475,23 @@ int EmulNet::ENcleanup() {
 	emulnet.nextid=0;
 	int i, j;
 	int sent_total, recv_total;
+	int buffdrop, randdrop, sizedrop;
+	int buffdrop_total = 0, randdrop_total = 0, sizedrop_total = 0;
 
 	FILE* file = fopen("msgcount.log", "w+");
 
-	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
+	for ( i = 0; i < (int)emulnet.inbox.size(); i++ ) {
+		for ( j = 0; j < (int)emulnet.inbox[i].size(); j++ ) {
+			ENfree(emulnet.inbox[i][j].data);
+		}
+		emulnet.inbox[i].clear();
+	}
+	vector<en_msg> held;
+	wheel.clear(held);
+	for ( i = 0; i < (int)held.size(); i++ ) {
+		ENfree(held[i].data);
 	}
+	emulnet.currbuffsize = 0;
 
 	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
 		fprintf(file, "node %3d ", i);
@@ -199,22 +500,36 @@ int EmulNet::ENcleanup() {
 
 		for (j = 0; j < par->getcurrtime(); j++) {
 
-			sent_total += sent_msgs[i][j];
-			recv_total += recv_msgs[i][j];
+			int sent = getCount(sent_msgs, i, j);
+			int recv = getCount(recv_msgs, i, j);
+			sent_total += sent;
+			recv_total += recv;
 			if (i != 67) {
-				fprintf(file, " (%4d, %4d)", sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, " (%4d, %4d)", sent, recv);
 				if (j % 10 == 9) {
 					fprintf(file, "\n         ");
 				}
 			}
 			else {
-				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, "special %4d %4d %4d\n", j, sent, recv);
 			}
 		}
 		fprintf(file, "\n");
-		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n\n", i, sent_total, recv_total);
+		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n", i, sent_total, recv_total);
+		buffdrop = (size_t)i < buffdrop_msgs.size() ? buffdrop_msgs[i] : 0;
+		randdrop = (size_t)i < randdrop_msgs.size() ? randdrop_msgs[i] : 0;
+		sizedrop = (size_t)i < sizedrop_msgs.size() ? sizedrop_msgs[i] : 0;
+		fprintf(file, "node %3d buffer_drops %6u  random_drops %6u  size_drops %6u\n\n", i, buffdrop, randdrop, sizedrop);
+		buffdrop_total += buffdrop;
+		randdrop_total += randdrop;
+		sizedrop_total += sizedrop;
 	}
 
+	fprintf(file, "buffer_drops %u  random_drops %u  size_drops %u\n", buffdrop_total, randdrop_total, sizedrop_total);
+
+	fprintf(file, "delayed %lu  avg_delay %.2f\n", delayed_msgs, delayed_msgs ? (double)delay_total / delayed_msgs : 0.0);
+	fprintf(file, "buffer pool hits %lu  misses %lu\n", pool.hits, pool.misses);
+
 	fclose(file);
 	return 0;
 }
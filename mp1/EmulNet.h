@@ -7,9 +7,11 @@
 #ifndef _EMULNET_H_
 #define _EMULNET_H_
 
-#define MAX_NODES 1000
-#define MAX_TIME 3600
-#define ENBUFFSIZE 30000
+// Message buffer pool: size classes of 2^POOL_MIN_SHIFT .. 2^(POOL_MIN_SHIFT+POOL_CLASSES-1) bytes
+#define POOL_MIN_SHIFT 5
+#define POOL_CLASSES 8
+// Number of slots of the delivery timing wheel (power of two)
+#define WHEEL_SLOTS 256
 
 #include "stdincludes.h"
 #include "Params.h"
@@ -21,14 +23,53 @@ using namespace std;
  * Struct Name: en_msg
  */
 typedef struct en_msg {
-	// Number of bytes after the class
+	// Number of bytes in the payload
 	int size;
 	// Source node
 	Address from;
 	// Destination node
 	Address to;
+	// Payload, allocated once at send time and owned by whoever holds the message
+	char *data;
+	// Earliest time at which a delayed message may be received
+	int due;
 }en_msg;
 
+/**
+ * Struct Name: pool_hdr
+ *
+ * DESCRIPTION: Header placed in front of every pooled payload
+ */
+typedef struct pool_hdr {
+	// Size class the buffer belongs to (POOL_CLASSES for oversized buffers)
+	int sizeclass;
+	// Number of holders of the buffer, it is recycled when this drops to 0
+	int refs;
+}pool_hdr;
+
+/**
+ * CLASS NAME: MsgPool
+ *
+ * DESCRIPTION: Recycles message payload buffers through per size class free lists
+ * 				so that steady state traffic does not go to the general purpose allocator
+ */
+class MsgPool {
+private:
+	vector<pool_hdr *> freelist[POOL_CLASSES];
+	MsgPool(const MsgPool &anotherPool);
+	MsgPool& operator = (const MsgPool &anotherPool);
+public:
+	// Allocations served from a free list
+	unsigned long hits;
+	// Allocations that had to call malloc
+	unsigned long misses;
+	MsgPool(): hits(0), misses(0) {}
+	char *alloc(int size);
+	void retain(char *buff, int count);
+	void release(char *buff);
+	virtual ~MsgPool();
+};
+
 /**
  * Class Name: EM
  */
@@ -37,19 +78,31 @@ public:
 	int nextid;
 	int currbuffsize;
 	int firsteltindex;
-	en_msg* buff[ENBUFFSIZE];
+	// In-flight messages, one inbox per destination node id
+	vector< vector<en_msg> > inbox;
 	EM() {}
 	EM& operator = (EM &anotherEM) {
 		this->nextid = anotherEM.getNextId();
 		this->currbuffsize = anotherEM.getCurrBuffSize();
 		this->firsteltindex = anotherEM.getFirstEltIndex();
-		int i = this->currbuffsize;
-		while (i > 0) {
-			this->buff[i] = anotherEM.buff[i];
-			i--;
-		}
+		this->inbox = anotherEM.inbox;
 		return *this;
 	}
+	/**
+	 * Returns the inbox of the node whose id is written in addr[0..3],
+	 * growing the table if the id has not been seen yet
+	 */
+	vector<en_msg>& getInbox(Address *addr) {
+		int id;
+		memcpy(&id, &addr->addr[0], sizeof(int));
+		if ( id < 0 ) {
+			id = 0;
+		}
+		if ( (size_t)id >= inbox.size() ) {
+			inbox.resize(id + 1);
+		}
+		return inbox[id];
+	}
 	int getNextId() {
 		return nextid;
 	}
@@ -71,19 +124,58 @@ public:
 	virtual ~EM() {}
 };
 
+/**
+ * CLASS NAME: TimingWheel
+ *
+ * DESCRIPTION: Hashed timing wheel holding delayed messages until they are due.
+ * 				A message due at time t lives in slot t % WHEEL_SLOTS, so scheduling
+ * 				is O(1) and releasing a tick only looks at that tick's slot.
+ * 				Messages more than one revolution away stay in their slot until due.
+ */
+class TimingWheel {
+private:
+	vector<en_msg> slots[WHEEL_SLOTS];
+	// Last tick whose slot was released
+	int lasttick;
+public:
+	// Number of messages currently held in the wheel
+	int pending;
+	TimingWheel(): lasttick(0), pending(0) {}
+	void schedule(en_msg &msg);
+	int expire(int time, EM &emulnet);
+	void clear(vector<en_msg> &out);
+	virtual ~TimingWheel() {}
+};
+
 /**
  * CLASS NAME: EmulNet
  *
  * DESCRIPTION: This class defines an emulated network
  */
 class EmulNet
-{ 	
+{
 private:
 	Params* par;
-	int sent_msgs[MAX_NODES + 1][MAX_TIME];
-	int recv_msgs[MAX_NODES + 1][MAX_TIME];
+	// Per node id, per tick message counters, grown on demand
+	vector< vector<int> > sent_msgs;
+	vector< vector<int> > recv_msgs;
+	// Per node id totals of messages dropped because the in-flight store was full
+	vector<int> buffdrop_msgs;
+	// Per node id totals of messages dropped by the emulated MSG_DROP_PROB loss
+	vector<int> randdrop_msgs;
+	// Per node id totals of messages dropped for being larger than MAX_MSG_SIZE
+	vector<int> sizedrop_msgs;
 	int enInited;
 	EM emulnet;
+	MsgPool pool;
+	TimingWheel wheel;
+	// Number of delayed messages and the sum of their delays
+	unsigned long delayed_msgs;
+	unsigned long delay_total;
+	int drawDelay();
+	void countMsg(vector< vector<int> > &counts, int node, int time);
+	int getCount(vector< vector<int> > &counts, int node, int time);
+	void countDrop(vector<int> &counts, int node);
 public:
  	EmulNet(Params *p);
  	EmulNet(EmulNet &anotherEmulNet);
@@ -92,6 +184,11 @@ public:
 	void *ENinit(Address *myaddr, short port);
 	int ENsend(Address *myaddr, Address *toaddr, string data);
 	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
+	int ENsendOwned(Address *myaddr, Address *toaddr, char *data, int size);
+	int ENmulticast(Address *myaddr, vector<Address> &toaddrs, string data);
+	int ENmulticast(Address *myaddr, vector<Address> &toaddrs, char *data, int size);
+	char *ENalloc(int size);
+	void ENfree(char *buff);
 	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
 	int ENcleanup();
 };
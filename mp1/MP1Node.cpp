@@ -25,6 +25,14 @@ MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Addres
 	this->log = log;
 	this->par = params;
 	this->memberNode->addr = *address;
+	this->gossipRound = 0;
+	this->lastGossip = -1;
+	this->probeSeq = 0;
+	this->probeTarget = -1;
+	this->probeStart = 0;
+	this->probeIndirect = false;
+	this->probeCursor = 0;
+	this->piggyCursor = 0;
 }
 
 /**
@@ -132,7 +140,7 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
     }
     else {
         size_t msgsize = sizeof(MessageHdr) + sizeof(joinaddr->addr) + sizeof(long) + 1;
-        msg = (MessageHdr *) malloc(msgsize * sizeof(char));
+        msg = (MessageHdr *) emulNet->ENalloc(msgsize * sizeof(char));
 
         // create JOINREQ message: format of data is {struct Address myaddr}
         msg->msgType = JOINREQ;
@@ -144,10 +152,8 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
         log->LOG(&memberNode->addr, s);
 #endif
 
-        // send JOINREQ message to introducer member
-        emulNet->ENsend(&memberNode->addr, joinaddr, (char *)msg, msgsize);
-
-        free(msg);
+        // send JOINREQ message to introducer member, EmulNet takes ownership of msg
+        emulNet->ENsendOwned(&memberNode->addr, joinaddr, (char *)msg, msgsize);
     }
 
     return 1;
@@ -206,6 +212,8 @@ void MP1Node::checkMessages() {
     	size = memberNode->mp1q.front().size;
     	memberNode->mp1q.pop();
     	recvCallBack((void *)memberNode, (char *)ptr, size);
+    	// the buffer was allocated by the sender and handed over by EmulNet
+    	emulNet->ENfree((char *)ptr);
     }
     return;
 }
@@ -250,6 +258,15 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
 			//update personal heartbeat
 			memberNode->heartbeat ++;
 			return true;
+		 case PING :
+		 	handle_ping (data, size);
+			return true;
+		 case PINGREQ :
+		 	handle_pingreq (data, size);
+			return true;
+		 case ACK :
+		 	handle_ack (data, size);
+			return true;
 		 default :
 		  	return false;
 	 }
@@ -278,12 +295,19 @@ void MP1Node::nodeLoopOps() {
 	size_t i;
 	long cur_time, node_time ;
 	Address removed_addr;
-	vector<MemberListEntry>::iterator it = memberNode->memberList.begin();
+
+	//the SWIM detector fails nodes on missed probes instead of stale heartbeats
+	if (par->MP1_PROTOCOL == SWIM_PROTOCOL){
+		swim_ops();
+		return;
+	}
 
 	//print membership list
 
-	//for each entry : Check timestamp & change heartbeat to invalid if necessary
-	for (i=0; i<memberNode->memberList.size(); i++, it++){
+	//for each entry except myself (entry 0): Check timestamp & change heartbeat
+	//to invalid if necessary
+	i = 1;
+	while (i<memberNode->memberList.size()){
 		cur_time = par->getcurrtime();
 		node_time = memberNode->memberList[i].timestamp;
 		//Check timestamp
@@ -296,16 +320,15 @@ void MP1Node::nodeLoopOps() {
 			#ifdef DEBUGLOG
 			        log->logNodeRemove(&memberNode->addr, &removed_addr);
 			#endif
-			//delete entry
-			memberNode->memberList.erase(it);
-			//set i & iterator back to get next node
-			i--;
-			it--;
+			//delete entry, the last entry moves into slot i so check it next
+			removeMember(i);
+			continue;
 		}
 		else if( (cur_time-node_time) >TFAIL){
 			//mark node as failed
-			memberNode->memberList[i].heartbeat =-1;
+			failMember(i);
 		}
+		i++;
 	}
 	//print membership list
 	//cout<<L();
@@ -351,13 +374,14 @@ Address MP1Node::getJoinAddress() {
  */
 void MP1Node::initMemberListTable(Member *memberNode) {
 	memberNode->memberList.clear();
+	memberNode->memberIndex.clear();
 	//add first value (self) to the membership list
 	MemberListEntry my_entry;
 	//convert address|port|heartbeat to membership entry
 	addr2Entry(my_entry, memberNode->addr, memberNode->heartbeat,
 			   par->getcurrtime());
 	//store entry into list
-	memberNode->memberList.push_back(my_entry);
+	addMember(my_entry);
 }
 
 /**
@@ -390,6 +414,7 @@ void MP1Node:: handle_request (char* data, int size){
 	int id;
 	short port;
 	long heartbeat;
+	int pos;
 	Address in_addr;
 	MemberListEntry join_entry;
 
@@ -400,8 +425,15 @@ void MP1Node:: handle_request (char* data, int size){
 	memcpy (&in_addr.addr[4], &port, sizeof(short));
 	//conver to entry
 	addr2Entry (join_entry, in_addr, heartbeat, par->getcurrtime());
-	//store in membership list
-	memberNode->memberList.push_back(join_entry);
+	//store in membership list, or refresh the entry if the node joined before
+	pos = findMember(id);
+	if (pos < 0)
+		addMember(join_entry);
+	else{
+		if (memberNode->memberList[pos].heartbeat < 0)
+			memberNode->logEvent(MEMBER_JOIN, join_entry);
+		memberNode->memberList[pos] = join_entry;
+	}
 
 	//send out reply with membership list to join node
 	send_list (&in_addr, memberNode->memberList.size(), JOINREP);
@@ -427,13 +459,11 @@ void MP1Node:: handle_request (char* data, int size){
 void MP1Node:: handle_reply  (char* data, int size){
 	//Local Variables
 	int id;
-	size_t j;
 	short port;
 	long heartbeat, real_size, entries, entry_size, i;
 	Address in_addr;
 	MemberListEntry new_entry;
 	char* entry_ptr = data + sizeof(MessageHdr);
-	vector <MemberListEntry> ::iterator it;
 
 	//add yourself to group
 	memberNode->inGroup = true;
@@ -459,15 +489,8 @@ void MP1Node:: handle_reply  (char* data, int size){
 		//Convert to Membership entry
 		addr2Entry(new_entry, in_addr, heartbeat, par->getcurrtime());
 		//push into membership list if not inside
-		for (j =0; j<memberNode->memberList.size(); j++){
-			if (memberNode->memberList[j].id == id){
-				//update entry
-				break;
-			}
-
-		}
-		if (j ==memberNode->memberList.size())
-			memberNode->memberList.push_back(new_entry);
+		if (findMember(id) < 0)
+			addMember(new_entry);
 	}
 
 	//print out new membership list
@@ -487,45 +510,80 @@ void MP1Node:: handle_reply  (char* data, int size){
  */
 void MP1Node:: handle_gossip_in  (char* data, int size){
 	//Local Variables
-	size_t i;
-	int id;
-	short port;
-	long entry_no, entry_size, entries, heartbeat, real_size;
-	char * msg_ptr;
-	MemberListEntry new_member;
+	long entry_size, entries, real_size;
 
 	//find the number of entries
 	real_size = size - sizeof(MessageHdr);
 	entry_size = sizeof(Address) + 1 + sizeof(long);
 	entries = real_size/entry_size;
 
-	//msg_ptr = (char*) malloc (entry_size*entries);
-
 	// printAddress(&memberNode->addr);
 	// cout<< "Got a gossip with "<<entries<< " entries. "<< real_size<<"real_size. "
 	// <<entry_size<<"entry size"<<endl;
 	//cout<< "Gossip in"<<endl;
 
+	//merge the entries that follow the header
+	merge_entries(data + sizeof(MessageHdr), entries);
+}
 
-	//get the start of the entry
-	msg_ptr = data + sizeof(MessageHdr);
+/**
+ * FUNCTION NAME: merge_entries
+ *
+ * DESCRIPTION: Merges serialized membership entries into the membership list
+ *				and applies the SWIM verdicts they carry. A verdict only counts if
+ *				its heartbeat is not older than the one known here: a newer
+ *				heartbeat means the node was heard from after being suspected.
+ *
+ * Inputs : msg_ptr - a pointer to the first entry (|Address|SwimState|Heartbeat)
+ *			entries - number of entries
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: merge_entries (char* msg_ptr, long entries){
+	//Local Variables
+	int i;
+	int id;
+	short port;
+	char state;
+	long entry_no, entry_size, heartbeat;
+	MemberListEntry new_member;
+
+	entry_size = sizeof(Address) + 1 + sizeof(long);
 
 	//For each of the entries
 	for (entry_no =0; entry_no<entries; entry_no++){
 		//extract content fomr the entry
 		msg2var(msg_ptr + (entry_size*entry_no), id, port, heartbeat);
+		state = msg_ptr[entry_size*entry_no + sizeof(Address)];
 		//find the MLE to update
-		//go through membership list and chech for target id
-		for (i=0; i<memberNode->memberList.size(); i++){
-			if (memberNode->memberList[i].id == id)
-				break;
+		i = findMember(id);
+		//suspect or confirm record
+		if (state != SWIM_ALIVE){
+			//unknown, already failed or stale: nothing to do. A node suspected
+			//itself refutes it with its next heartbeat, which grows every tick
+			if (i <= 0 || memberNode->memberList[i].heartbeat < 0
+				|| memberNode->memberList[i].heartbeat > heartbeat)
+				continue;
+			if (state == SWIM_CONFIRM){
+				confirmed[id] = memberNode->memberList[i].heartbeat;
+				failMember(i);
+				memberNode->memberList[i].timestamp = par->getcurrtime();
+				suspects.erase(id);
+			}
+			else if (suspects.find(id) == suspects.end())
+				suspects[id] = par->getcurrtime();
+			else
+				continue;
+			//pass the verdict on with the next probes
+			memberNode->memberList[i].lastChanged = par->getcurrtime();
+			continue;
 		}
 		//if entry does not exist
-		if (i== memberNode->memberList.size()){
+		if (i < 0){
 			//add entry to the list if node is alive
 			if (heartbeat>=0){
 				new_member = MemberListEntry(id, port, heartbeat, par->getcurrtime());
-				memberNode->memberList.push_back(new_member);
+				addMember(new_member);
 			}
 		}
 		else{
@@ -534,7 +592,9 @@ void MP1Node:: handle_gossip_in  (char* data, int size){
 				//update heartbeat & timestamp
 				memberNode->memberList[i].heartbeat = heartbeat;
 				memberNode->memberList[i].timestamp = par->getcurrtime();
-
+				memberNode->memberList[i].lastChanged = par->getcurrtime();
+				//a newer heartbeat refutes any suspicion
+				suspects.erase(id);
 			}
 		}
 
@@ -550,65 +610,93 @@ void MP1Node:: handle_gossip_in  (char* data, int size){
 
 //////////////////////////// GOSSIP FUNCITONS //////////////////////////////////
 /**
- * FUNCTION NAME: send_list
+ * FUNCTION NAME: build_list
  *
- * DESCRIPTION: Sends this nodes membership ist to the requested node
+ * DESCRIPTION: Serializes this nodes membership list into a buffer from the EmulNet pool
  *
- * Inputs : to_addr - address to send list to
- *			no - no of entries to send (-1 means all)
+ * Inputs : no - no of entries to send
+ *			type - message type to put in the header
+ *			since - only send entries that changed at or after this time
+ *					(-1 means all), this node's own entry is always sent
+ *			msg_size - set to the size of the message
  *
- * Return Value : nothing
+ * Return Value : the message, to be handed to EmulNet
  */
-void MP1Node:: send_list (Address * to_addr, int no, MsgTypes type){
+char* MP1Node:: build_list (int no, MsgTypes type, long since, long& msg_size){
 	//Local Variables
-	long i, entries, msg_size, entry_size;
+	long i, entries, entry_size, chosen;
 	char* message, *msg_ptr;
 	MemberListEntry chosen_entry;
 	Address entry_addr;
+	vector <long> picked;
 
 
 
-	//get total message size
+	//pick the entries to send
 	entries =memberNode->memberList.size();
-	msg_size = sizeof(MessageHdr) + (entries * (sizeof(Address) + 1 + sizeof (long)));
+	for (i =0; i<entries && i < no ; i++){
+		chosen_entry = memberNode->memberList[i];
+		//if entry is invalid, skep
+		if (chosen_entry.timestamp ==-1)
+			continue;
+		//skip entries that have not changed since the last gossip
+		if (i > 0 && chosen_entry.lastChanged < since)
+			continue;
+		picked.push_back(i);
+	}
+
+	//get total message size
 	entry_size = sizeof(Address) + 1 + sizeof (long);
-	//allocate space for the message on the heap
-	message =  (char*) malloc (msg_size);
+	msg_size = sizeof(MessageHdr) + (picked.size() * entry_size);
+	//allocate space for the message from the EmulNet buffer pool
+	message =  emulNet->ENalloc (msg_size);
 
 	//add header
 	memcpy (message, (char*)&type , sizeof(MessageHdr));
 	msg_ptr = message +sizeof(MessageHdr);
 
 	//Assemble message
-	for (i =0; i<entries && i < no ; i++){
+	for (i =0; i<(long)picked.size(); i++){
 		//Get Membership entry
-		chosen_entry = memberNode->memberList[i];
+		chosen = picked[i];
+		chosen_entry = memberNode->memberList[chosen];
 
-		//if entry is invalid, skep
-		if (chosen_entry.timestamp ==-1){
-			msg_ptr += entry_size;
-			continue;
-		}
 		//Get address from entry
 		memcpy (&entry_addr.addr, &chosen_entry.id, sizeof(int));
 		memcpy (&entry_addr.addr[4], &chosen_entry.port, sizeof(short));
 
 		//put information at the back of the entry : |Address|1|Heartbeat
 		memcpy (msg_ptr, &entry_addr, sizeof(Address));
+		msg_ptr[sizeof(Address)] = SWIM_ALIVE;
 		memcpy (msg_ptr + 1 + sizeof(Address), &chosen_entry.heartbeat, sizeof(long));
 
 		//update pointer to next message location
 		msg_ptr += entry_size;
 	}
 
-	//send message
-	emulNet->ENsend(&memberNode->addr, to_addr, message, msg_size);
+	return message;
+}
+
+/**
+ * FUNCTION NAME: send_list
+ *
+ * DESCRIPTION: Sends this nodes membership ist to the requested node
+ *
+ * Inputs : to_addr - address to send list to
+ *			no - no of entries to send (-1 means all)
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: send_list (Address * to_addr, int no, MsgTypes type){
+	//Local Variables
+	long msg_size;
+	char* message = build_list(no, type, -1, msg_size);
+
+	//send message, EmulNet takes ownership of the buffer
+	emulNet->ENsendOwned(&memberNode->addr, to_addr, message, msg_size);
 
 	//update own heartbeat
 	memberNode->memberList[0].heartbeat = ++memberNode->heartbeat;
-
-	//delete any variables
-	delete message;
 }
 
 
@@ -625,13 +713,19 @@ void MP1Node:: gossip_out (){
 	//Local Variables
 	long b, list_size, no;
 	long sent_gossips=0;
+	long msg_size, since;
+	char* message;
 	MemberListEntry chosen_entry;
 	Address out_addr;
+	vector <Address> targets;
 	vector <int> store;   //push no to the back when used
 	vector <int> ::iterator it;
 
 
 	list_size =memberNode->memberList.size();
+	//nobody to gossip to yet (e.g. every join request was dropped)
+	if (list_size < 2)
+		return;
 	b =((list_size-1) /2) +1;;
 	//Get b random membership list entries and send to them
 	while (sent_gossips<b){
@@ -657,9 +751,19 @@ void MP1Node:: gossip_out (){
 
 		//send the membership list to chosen address at entry
 		if (chosen_entry.heartbeat >=0)
-			send_list(&out_addr, list_size, GOSSIP) ;
+			targets.push_back(out_addr);
 		sent_gossips++;
 	}
+	//serialize the list once and share it between all chosen nodes:
+	//a full sync every FULL_SYNC_PERIOD rounds to repair lost gossips,
+	//otherwise only what changed since the previous round
+	if (!targets.empty()){
+		since = (gossipRound % FULL_SYNC_PERIOD == 0) ? -1 : lastGossip + 1;
+		message = build_list(list_size, GOSSIP, since, msg_size);
+		emulNet->ENmulticast(&memberNode->addr, targets, message, msg_size);
+		gossipRound++;
+		lastGossip = par->getcurrtime();
+	}
 	// printAddress(&memberNode->addr);
 	// //cout<< " Sent out "<< sssent_gossips<< " entries"<<endl;
 
@@ -682,6 +786,346 @@ void MP1Node:: gossip_out (){
 
 
 
+//////////////////////////// SWIM FUNCTIONS ////////////////////////////////////
+//  SWIM message: |header|seq|subject Address|origin Address|entry|entry|...
+//  The first entry is always the sender's own, which is how the receiver
+//  knows who to answer. subject is the node being probed, origin the node
+//  that started the probe and is waiting for the ACK.
+
+/**
+ * FUNCTION NAME: build_swim
+ *
+ * DESCRIPTION: Serializes a SWIM message with piggybacked membership updates
+ *				into a buffer from the EmulNet pool
+ *
+ * Inputs : type - PING, PINGREQ or ACK
+ *			seq - sequence number of the probe
+ *			subject - node being probed
+ *			origin - node that started the probe
+ *			msg_size - set to the size of the message
+ *
+ * Return Value : the message, to be handed to EmulNet
+ */
+char* MP1Node:: build_swim (MsgTypes type, long seq, Address* subject, Address* origin, long& msg_size){
+	//Local Variables
+	long i, entries, entry_size, scanned, recent, heartbeat;
+	char* message, *msg_ptr;
+	MemberListEntry chosen_entry;
+	Address entry_addr;
+	vector <long> picked;
+
+	//always carry my own entry first, then up to SWIM_PIGGYBACK entries that
+	//changed within the last period, starting where the last one stopped:
+	//live and suspected entries, and failed ones until they are removed
+	picked.push_back(0);
+	entries = memberNode->memberList.size();
+	recent = par->getcurrtime() - SWIM_PERIOD;
+	for (scanned =0; scanned<entries-1 && (long)picked.size()<=SWIM_PIGGYBACK; scanned++){
+		piggyCursor = (piggyCursor % (entries-1)) + 1;
+		chosen_entry = memberNode->memberList[piggyCursor];
+		if (chosen_entry.lastChanged >= recent
+			&& (chosen_entry.heartbeat >=0 || confirmed.count(chosen_entry.id)))
+			picked.push_back(piggyCursor);
+	}
+
+	//get total message size
+	entry_size = sizeof(Address) + 1 + sizeof (long);
+	msg_size = sizeof(MessageHdr) + sizeof(long) + 2*sizeof(Address) + (picked.size() * entry_size);
+	message = emulNet->ENalloc (msg_size);
+
+	//add header, sequence number and addresses
+	memcpy (message, (char*)&type, sizeof(MessageHdr));
+	msg_ptr = message + sizeof(MessageHdr);
+	memcpy (msg_ptr, &seq, sizeof(long));
+	msg_ptr += sizeof(long);
+	memcpy (msg_ptr, subject->addr, sizeof(Address));
+	msg_ptr += sizeof(Address);
+	memcpy (msg_ptr, origin->addr, sizeof(Address));
+	msg_ptr += sizeof(Address);
+
+	//add the piggybacked entries : |Address|SwimState|Heartbeat
+	//a confirm record carries the last heartbeat heard before the failure
+	memset (msg_ptr, 0, picked.size() * entry_size);
+	for (i =0; i<(long)picked.size(); i++){
+		chosen_entry = memberNode->memberList[picked[i]];
+		entry2Addr(chosen_entry, entry_addr);
+		heartbeat = chosen_entry.heartbeat;
+		memcpy (msg_ptr, &entry_addr, sizeof(Address));
+		if (heartbeat < 0){
+			msg_ptr[sizeof(Address)] = SWIM_CONFIRM;
+			heartbeat = confirmed[chosen_entry.id];
+		}
+		else if (suspects.find(chosen_entry.id) != suspects.end())
+			msg_ptr[sizeof(Address)] = SWIM_SUSPECT;
+		memcpy (msg_ptr + 1 + sizeof(Address), &heartbeat, sizeof(long));
+		msg_ptr += entry_size;
+	}
+
+	return message;
+}
+
+/**
+ * FUNCTION NAME: send_swim
+ *
+ * DESCRIPTION: Builds a SWIM message and sends it
+ *
+ * Inputs : to_addr - address to send the message to
+ *			type, seq, subject, origin - see build_swim
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: send_swim (Address* to_addr, MsgTypes type, long seq, Address* subject, Address* origin){
+	long msg_size;
+	char* message = build_swim(type, seq, subject, origin, msg_size);
+
+	//EmulNet takes ownership of the buffer
+	emulNet->ENsendOwned(&memberNode->addr, to_addr, message, msg_size);
+}
+
+/**
+ * FUNCTION NAME: swim2var
+ *
+ * DESCRIPTION: Extracts the SWIM fields of a message and merges its piggybacked entries
+ *
+ * Inputs : data - the message
+ *			size - size of the message
+ *			seq, subject, origin - set from the message
+ *			sender - set to the address in the first piggybacked entry
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: swim2var (char* data, int size, long& seq, Address& subject, Address& origin, Address& sender){
+	//Local Variables
+	long entry_size, entries;
+	char* msg_ptr = data + sizeof(MessageHdr);
+
+	memcpy (&seq, msg_ptr, sizeof(long));
+	msg_ptr += sizeof(long);
+	memcpy (subject.addr, msg_ptr, sizeof(Address));
+	msg_ptr += sizeof(Address);
+	memcpy (origin.addr, msg_ptr, sizeof(Address));
+	msg_ptr += sizeof(Address);
+	memcpy (sender.addr, msg_ptr, sizeof(Address));
+
+	entry_size = sizeof(Address) + 1 + sizeof(long);
+	entries = (size - (msg_ptr - data)) / entry_size;
+	merge_entries(msg_ptr, entries);
+}
+
+/**
+ * FUNCTION NAME: handle_ping
+ *
+ * DESCRIPTION: Answers a probe. The ACK goes back to whoever sent the PING,
+ *				which is the origin itself or a member probing on its behalf.
+ *
+ * Inputs : data - a pointer to the incoming message
+ *			size - size of the incoming message
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: handle_ping (char* data, int size){
+	long seq;
+	Address subject, origin, sender;
+
+	swim2var(data, size, seq, subject, origin, sender);
+	send_swim(&sender, ACK, seq, &memberNode->addr, &origin);
+}
+
+/**
+ * FUNCTION NAME: handle_pingreq
+ *
+ * DESCRIPTION: Probes the subject on behalf of the origin
+ *
+ * Inputs : data - a pointer to the incoming message
+ *			size - size of the incoming message
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: handle_pingreq (char* data, int size){
+	long seq;
+	Address subject, origin, sender;
+
+	swim2var(data, size, seq, subject, origin, sender);
+	send_swim(&subject, PING, seq, &subject, &origin);
+}
+
+/**
+ * FUNCTION NAME: handle_ack
+ *
+ * DESCRIPTION: Completes this node's probe, or relays the ACK to the origin
+ *				of an indirect probe
+ *
+ * Inputs : data - a pointer to the incoming message
+ *			size - size of the incoming message
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: handle_ack (char* data, int size){
+	long seq;
+	int id, pos;
+	Address subject, origin, sender;
+
+	swim2var(data, size, seq, subject, origin, sender);
+
+	//an ACK for someone else's probe: pass it on
+	if (!(origin == memberNode->addr)){
+		send_swim(&origin, ACK, seq, &subject, &origin);
+		return;
+	}
+
+	//the subject is alive
+	memcpy (&id, &subject.addr, sizeof(int));
+	suspects.erase(id);
+	pos = findMember(id);
+	if (pos > 0 && memberNode->memberList[pos].heartbeat >= 0)
+		memberNode->memberList[pos].timestamp = par->getcurrtime();
+	if (id == probeTarget && seq == probeSeq)
+		probeTarget = -1;
+}
+
+/**
+ * FUNCTION NAME: next_probe_target
+ *
+ * DESCRIPTION: Picks the next node to probe. Suspected nodes are probed again
+ *				first, otherwise members are visited in a randomized round-robin
+ *				order that is reshuffled after each pass.
+ *
+ * Return Value : id of the node to probe, -1 if there is nobody
+ */
+int MP1Node:: next_probe_target (){
+	//Local Variables
+	size_t i, j;
+	int id, pos;
+	map <int, long> ::iterator sus_it;
+
+	//re-probe a suspect so one lost ACK does not turn into a failure
+	for (sus_it = suspects.begin(); sus_it != suspects.end(); sus_it++){
+		if (findMember(sus_it->first) > 0)
+			return sus_it->first;
+	}
+
+	for (j =0; j<2; j++){
+		//walk the current order, skipping nodes that left or failed since
+		for (; probeCursor<probeOrder.size(); probeCursor++){
+			id = probeOrder[probeCursor];
+			pos = findMember(id);
+			if (pos > 0 && memberNode->memberList[pos].heartbeat >= 0){
+				probeCursor++;
+				return id;
+			}
+		}
+		//start a new pass over a fresh shuffle of the live members
+		probeOrder.clear();
+		probeCursor = 0;
+		for (i =1; i<memberNode->memberList.size(); i++){
+			if (memberNode->memberList[i].heartbeat >= 0)
+				probeOrder.push_back(memberNode->memberList[i].id);
+		}
+		for (i =probeOrder.size(); i>1; i--)
+			swap(probeOrder[i-1], probeOrder[rand() % i]);
+	}
+	return -1;
+}
+
+/**
+ * FUNCTION NAME: swim_ops
+ *
+ * DESCRIPTION: SWIM duties of one tick: ages suspicions and failed entries,
+ *				escalates a probe without a direct ACK to SWIM_K indirect probes,
+ *				and starts a new probe every SWIM_PERIOD ticks
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: swim_ops (){
+	//Local variables
+	size_t i;
+	long cur_time = par->getcurrtime();
+	int id, pos;
+	Address removed_addr, target_addr, helper_addr;
+	vector <int> helpers;
+	map <int, long> ::iterator sus_it;
+
+	//confirm suspicions that nobody refuted, and drop failed entries after TREMOVE
+	i = 1;
+	while (i<memberNode->memberList.size()){
+		MemberListEntry& entry = memberNode->memberList[i];
+		sus_it = suspects.find(entry.id);
+		if (entry.heartbeat < 0){
+			if ( (cur_time - entry.timestamp) > TREMOVE){
+				entry2Addr(entry, removed_addr);
+				#ifdef DEBUGLOG
+				        log->logNodeRemove(&memberNode->addr, &removed_addr);
+				#endif
+				confirmed.erase(entry.id);
+				removeMember(i);
+				continue;
+			}
+		}
+		else if (sus_it != suspects.end() && (cur_time - sus_it->second) > SWIM_SUSPECT_TIMEOUT){
+			//failed: keep the entry for TREMOVE so stale updates cannot revive it,
+			//and spread the confirmation
+			confirmed[entry.id] = entry.heartbeat;
+			failMember(i);
+			entry.timestamp = cur_time;
+			entry.lastChanged = cur_time;
+			suspects.erase(sus_it);
+		}
+		i++;
+	}
+
+	//follow up on the current probe
+	if (probeTarget >= 0){
+		pos = findMember(probeTarget);
+		if (pos <= 0 || memberNode->memberList[pos].heartbeat < 0){
+			probeTarget = -1;
+		}
+		else if (!probeIndirect && (cur_time - probeStart) >= SWIM_PING_TIMEOUT){
+			//no direct ACK: ask up to SWIM_K other live members to probe it
+			for (i =1; i<memberNode->memberList.size(); i++){
+				id = memberNode->memberList[i].id;
+				if (id != probeTarget && memberNode->memberList[i].heartbeat >= 0
+					&& suspects.find(id) == suspects.end())
+					helpers.push_back(id);
+			}
+			entry2Addr(memberNode->memberList[pos], target_addr);
+			for (i =0; i<helpers.size() && i<SWIM_K; i++){
+				swap(helpers[i], helpers[i + rand() % (helpers.size() - i)]);
+				entry2Addr(memberNode->memberList[findMember(helpers[i])], helper_addr);
+				send_swim(&helper_addr, PINGREQ, probeSeq, &target_addr, &memberNode->addr);
+			}
+			probeIndirect = true;
+		}
+		else if (probeIndirect && (cur_time - probeStart) >= SWIM_PERIOD){
+			//no ACK at all within the period: suspect the target, and spread it
+			if (suspects.find(probeTarget) == suspects.end()){
+				suspects[probeTarget] = cur_time;
+				memberNode->memberList[pos].lastChanged = cur_time;
+			}
+			probeTarget = -1;
+		}
+	}
+
+	//start the next probe once per period
+	if (probeTarget < 0 && (cur_time - probeStart) >= SWIM_PERIOD){
+		id = next_probe_target();
+		if (id >= 0){
+			probeTarget = id;
+			probeStart = cur_time;
+			probeIndirect = false;
+			entry2Addr(memberNode->memberList[findMember(id)], target_addr);
+			send_swim(&target_addr, PING, ++probeSeq, &target_addr, &memberNode->addr);
+		}
+	}
+
+	//update own heartbeat once per tick
+	memberNode->memberList[0].heartbeat = ++memberNode->heartbeat;
+	memberNode->memberList[0].timestamp = cur_time;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+
 ////////////////////////////// CONVERSION FUNCTIONS ////////////////////////////
 /**
  * FUNCTION NAME: addr2Entry
@@ -710,6 +1154,22 @@ void MP1Node:: addr2Entry(MemberListEntry& entry, Address addr, long heartbeat,
 		entry.port = port;
 		entry.heartbeat = heartbeat;
 		entry.timestamp = local_time;
+		entry.lastChanged = local_time;
+}
+
+/**
+ * FUNCTION NAME: entry2Addr
+ *
+ * DESCRIPTION: Converts a membership entry to an address
+ *
+ * Inputs : entry- the membership entry to read
+ *			addr - the address to store into
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: entry2Addr(MemberListEntry& entry, Address& addr){
+		memcpy (&addr.addr, &entry.id, sizeof(int));
+		memcpy (&addr.addr[4], &entry.port, sizeof(short));
 }
 
 /**
@@ -740,6 +1200,88 @@ void MP1Node:: msg2var(char* addr_ptr, int& id, short& port, long& heartbeat){
 ////////////////////////////////////////////////////////////////////////////////
 
 
+
+
+
+////////////////////////////// MEMBERSHIP INDEX ////////////////////////////////
+/**
+ * FUNCTION NAME: findMember
+ *
+ * DESCRIPTION: Looks up a node id in the membership index
+ *
+ * Inputs : id - node id to look for
+ *
+ * Return Value : position of the node in the membership list, -1 if absent
+ */
+int MP1Node:: findMember (int id){
+	if (id < 0 || (size_t)id >= memberNode->memberIndex.size())
+		return -1;
+	return memberNode->memberIndex[id];
+}
+
+/**
+ * FUNCTION NAME: addMember
+ *
+ * DESCRIPTION: Appends an entry to the membership list and indexes it by id
+ *
+ * Inputs : entry - the membership entry to add (must not be in the list yet)
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: addMember (MemberListEntry& entry){
+	//grow the index to cover the new id
+	if ((size_t)entry.id >= memberNode->memberIndex.size())
+		memberNode->memberIndex.resize(entry.id + 1, -1);
+	memberNode->memberIndex[entry.id] = memberNode->memberList.size();
+	memberNode->memberList.push_back(entry);
+	//only live entries count as a join, failed ones never reach the ring
+	if (entry.heartbeat >= 0)
+		memberNode->logEvent(MEMBER_JOIN, entry);
+}
+
+/**
+ * FUNCTION NAME: removeMember
+ *
+ * DESCRIPTION: Removes an entry from the membership list in O(1) by moving the
+ *				last entry into its slot. Position 0 (this node) is never removed.
+ *
+ * Inputs : pos - position of the entry in the membership list
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: removeMember (size_t pos){
+	vector<MemberListEntry>& list = memberNode->memberList;
+
+	memberNode->logEvent(MEMBER_REMOVE, list[pos]);
+	memberNode->memberIndex[list[pos].id] = -1;
+	if (pos != list.size()-1){
+		list[pos] = list.back();
+		memberNode->memberIndex[list[pos].id] = pos;
+	}
+	list.pop_back();
+}
+
+/**
+ * FUNCTION NAME: failMember
+ *
+ * DESCRIPTION: Marks an entry of the membership list as failed (heartbeat -1)
+ *
+ * Inputs : pos - position of the entry in the membership list
+ *
+ * Return Value : nothing
+ */
+void MP1Node:: failMember (size_t pos){
+	MemberListEntry& entry = memberNode->memberList[pos];
+
+	if (entry.heartbeat < 0)
+		return;
+	entry.heartbeat = -1;
+	memberNode->logEvent(MEMBER_FAIL, entry);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+
 //Function that prints a node's membership list
 void MP1Node::printML(){
 	//local variables
@@ -9,6 +9,9 @@
 
 #include "stdincludes.h"
 
+// number of membership events a Member remembers
+#define MAX_MEMBER_EVENTS 64
+
 /**
  * CLASS NAME: q_elt
  *
@@ -65,9 +68,11 @@ public:
 	short port;
 	long heartbeat;
 	long timestamp;
+	// local time the heartbeat last changed, used to build delta gossips
+	long lastChanged;
 	MemberListEntry(int id, short port, long heartbeat, long timestamp);
 	MemberListEntry(int id, short port);
-	MemberListEntry(): id(0), port(0), heartbeat(0), timestamp(0) {}
+	MemberListEntry(): id(0), port(0), heartbeat(0), timestamp(0), lastChanged(0) {}
 	MemberListEntry(const MemberListEntry &anotherMLE);
 	MemberListEntry& operator =(const MemberListEntry &anotherMLE);
 	int getid();
@@ -80,6 +85,22 @@ public:
 	void settimestamp(long timestamp);
 };
 
+/**
+ * CLASS NAME: MemberEvent
+ *
+ * DESCRIPTION: A change to the membership list, numbered by the membership epoch
+ */
+enum MemberEventType { MEMBER_JOIN, MEMBER_FAIL, MEMBER_REMOVE };
+
+class MemberEvent {
+public:
+	long epoch;
+	MemberEventType type;
+	int id;
+	short port;
+	MemberEvent(long epoch, MemberEventType type, int id, short port): epoch(epoch), type(type), id(id), port(port) {}
+};
+
 /**
  * CLASS NAME: Member
  *
@@ -108,16 +129,26 @@ public:
 	vector<MemberListEntry> memberList;
 	// My position in the membership table
 	vector<MemberListEntry>::iterator myPos;
+	// Position of each node id in the membership table (-1 if not a member)
+	vector<int> memberIndex;
+	// Membership epoch, bumped on every join, failure and removal
+	long epoch;
+	// The last MAX_MEMBER_EVENTS membership changes, oldest first
+	deque<MemberEvent> events;
 	// Queue for failure detection messages
 	queue<q_elt> mp1q;
 	/**
 	 * Constructor
 	 */
-	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), pingCounter(0), timeOutCounter(0) {}
+	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), pingCounter(0), timeOutCounter(0), epoch(0) {}
 	// copy constructor
 	Member(const Member &anotherMember);
 	// Assignment operator overloading
 	Member& operator =(const Member &anotherMember);
+	// Record a membership change and advance the epoch
+	void logEvent(MemberEventType type, MemberListEntry &entry);
+	// Changes after epoch since, false if they are no longer all remembered
+	bool eventsSince(long since, vector<MemberEvent> &changes);
 	virtual ~Member() {}
 };
 
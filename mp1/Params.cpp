@@ -17,6 +17,8 @@ Params::Params(): PORTNUM(8001) {}
  * DESCRIPTION: Set the parameters for this test case
  */
 void Params::setparams(char *config_file) {
+	char key[64];
+	char value[64];
 	FILE *fp = fopen(config_file,"r");
 
 	fscanf(fp,"MAX_NNB: %d", &MAX_NNB);
@@ -24,6 +26,17 @@ void Params::setparams(char *config_file) {
 	fscanf(fp,"\nDROP_MSG: %d", &DROP_MSG);
 	fscanf(fp,"\nMSG_DROP_PROB: %lf", &MSG_DROP_PROB);
 
+	// Optional settings follow as "KEY: value" lines in any order
+	EN_BUFFSIZE = 0;
+	DELAY_MODEL = NO_DELAY;
+	DELAY_MIN = 0;
+	DELAY_MAX = 0;
+	DELAY_ALPHA = 1.5;
+	MP1_PROTOCOL = GOSSIP_PROTOCOL;
+	while ( fscanf(fp, " %63[^:]: %63s", key, value) == 2 ) {
+		setoption(key, value);
+	}
+
 	//printf("Parameters of the test case: %d %d %d %lf\n", MAX_NNB, SINGLE_FAILURE, DROP_MSG, MSG_DROP_PROB);
 
 	EN_GPSZ = MAX_NNB;
@@ -39,6 +52,44 @@ void Params::setparams(char *config_file) {
 	return;
 }
 
+/**
+ * FUNCTION NAME: setoption
+ *
+ * DESCRIPTION: Set one of the optional parameters of the test case.
+ * 				Unknown keys are ignored.
+ */
+void Params::setoption(char *key, char *value) {
+	if ( 0 == strcmp(key, "EN_BUFFSIZE") ) {
+		EN_BUFFSIZE = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "DELAY_MODEL") ) {
+		if ( 0 == strcmp(value, "FIXED") ) {
+			DELAY_MODEL = FIXED_DELAY;
+		}
+		else if ( 0 == strcmp(value, "UNIFORM") ) {
+			DELAY_MODEL = UNIFORM_DELAY;
+		}
+		else if ( 0 == strcmp(value, "PARETO") ) {
+			DELAY_MODEL = PARETO_DELAY;
+		}
+		else {
+			DELAY_MODEL = NO_DELAY;
+		}
+	}
+	else if ( 0 == strcmp(key, "DELAY_MIN") ) {
+		DELAY_MIN = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "DELAY_MAX") ) {
+		DELAY_MAX = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "DELAY_ALPHA") ) {
+		DELAY_ALPHA = atof(value);
+	}
+	else if ( 0 == strcmp(key, "MP1_PROTOCOL") ) {
+		MP1_PROTOCOL = ( 0 == strcmp(value, "SWIM") ) ? SWIM_PROTOCOL : GOSSIP_PROTOCOL;
+	}
+}
+
 /**
  * FUNCTION NAME: getcurrtime
  *
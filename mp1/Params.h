@@ -11,6 +11,8 @@
 #include "Params.h"
 #include "Member.h"
 
+enum delayTYPE { NO_DELAY, FIXED_DELAY, UNIFORM_DELAY, PARETO_DELAY };
+enum protocolTYPE { GOSSIP_PROTOCOL, SWIM_PROTOCOL };
 enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
 
 /**
@@ -31,8 +33,15 @@ public:
 	int globaltime;
 	int allNodesJoined;
 	short PORTNUM;
+	int EN_BUFFSIZE;			// max in-flight messages per EmulNet, 0 means unbounded
+	int DELAY_MODEL;			// delayTYPE of the emulated network latency
+	int DELAY_MIN;				// minimum extra delivery delay in ticks
+	int DELAY_MAX;				// maximum extra delivery delay in ticks
+	double DELAY_ALPHA;			// shape of the long tailed (Pareto) delay
+	int MP1_PROTOCOL;			// protocolTYPE of the membership failure detector
 	Params();
 	void setparams(char *);
+	void setoption(char *key, char *value);
 	int getcurrtime();
 };
 
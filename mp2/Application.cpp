@@ -120,6 +120,11 @@ int Application::run()
 		//fail();
 	}
 
+	// Every key left in the store should be back on all of its replicas
+	if ( par->CRUDTEST != DELETE_TEST ) {
+		replicaCheck();
+	}
+
 	// Clean up
 	en->ENcleanup();
 	en1->ENcleanup();
@@ -475,6 +480,42 @@ void Application::deleteTest() {
 	mp2[number]->clientDelete(invalidKey);
 }
 
+/**
+ * FUNCTION NAME: replicaCheck
+ *
+ * DESCRIPTION: Checks that each test key is held by all RF of its replicas, as seen from
+ * 				a live node, and that those replicas are alive. Logs the keys that are
+ * 				short of replicas and the number of keys that are not.
+ */
+void Application::replicaCheck() {
+	int number, i, j, holders, complete = 0;
+	ReplicaSet replicas;
+
+	number = findARandomNodeThatIsAlive();
+	for ( map<string, string>::iterator it = testKVPairs.begin(); it != testKVPairs.end(); ++it ) {
+		replicas = mp2[number]->findNodes(it->first);
+		holders = 0;
+		for ( j = 0; j < RF; j++ ) {
+			for ( i = 0; i < par->EN_GPSZ; i++ ) {
+				if ( mp2[i]->getMemberNode()->addr == replicas[j].nodeAddress ) {
+					break;
+				}
+			}
+			if ( i < par->EN_GPSZ && !mp2[i]->getMemberNode()->bFailed && mp2[i]->readKey(it->first) != NULL ) {
+				holders++;
+			}
+		}
+		if ( holders == RF ) {
+			complete++;
+		}
+		else {
+			log->LOG(&mp2[number]->getMemberNode()->addr, "REPLICA CHECK KEY: %s held by %d of %d replicas", it->first.c_str(), holders, RF);
+		}
+	}
+	log->LOG(&mp2[number]->getMemberNode()->addr, "REPLICA CHECK: %d of %d keys on all replicas", complete, (int)testKVPairs.size());
+	cout<<endl<<"Replica check: "<<complete<<" of "<<testKVPairs.size()<<" keys on all "<<RF<<" replicas"<<endl;
+}
+
 /**
  * FUNCTION NAME: readTest
  *
@@ -486,7 +527,7 @@ void Application::readTest() {
 	// This key is used for all read tests
 	map<string, string>::iterator it = testKVPairs.begin();
 	int number;
-	vector<Node> replicas;
+	ReplicaSet replicas;
 	int replicaIdToFail = TERTIARY;
 	int nodeToFail;
 	bool failedOneNode = false;
@@ -514,12 +555,11 @@ void Application::readTest() {
 		number = findARandomNodeThatIsAlive();
 
 		// Step 2.b Find the replicas of this key
-		replicas.clear();
 		replicas = mp2[number]->findNodes(it->first);
 		// if less than quorum replicas are found then exit
-		if ( replicas.size() < (RF-1) ) {
-			cout<<endl<<"Could not find at least quorum replicas for this key. Exiting!!! size of replicas vector: "<<replicas.size()<<endl;
-			log->LOG(&mp2[number]->getMemberNode()->addr, "Could not find at least quorum replicas for this key. Exiting!!! size of replicas vector: %d", replicas.size());
+		if ( mp2[number]->ringSize() < RF ) {
+			cout<<endl<<"Could not find at least quorum replicas for this key. Exiting!!! size of the ring: "<<mp2[number]->ringSize()<<endl;
+			log->LOG(&mp2[number]->getMemberNode()->addr, "Could not find at least quorum replicas for this key. Exiting!!! size of the ring: %zu", mp2[number]->ringSize());
 			exit(1);
 		}
 
@@ -581,12 +621,11 @@ void Application::readTest() {
 			number = findARandomNodeThatIsAlive();
 
 			// Get the keys replicas
-			replicas.clear();
 			replicas = mp2[number]->findNodes(it->first);
 
 			// Step 3.b. Fail two replicas
 			//cout<<"REPLICAS SIZE: "<<replicas.size();
-			if ( replicas.size() > 2 ) {
+			if ( mp2[number]->ringSize() >= RF ) {
 				replicaIdToFail = TERTIARY;
 				while ( count != 2 ) {
 					int i = 0;
@@ -611,7 +650,7 @@ void Application::readTest() {
 			}
 			else {
 				// If the code reaches here. Test your stabilization protocol
-				cout<<endl<<"Not enough replicas to fail two nodes. Number of replicas of this key: " <<replicas.size() <<". Exiting test case !! "<<endl;
+				cout<<endl<<"Not enough replicas to fail two nodes. Number of nodes on the ring: " <<mp2[number]->ringSize() <<". Exiting test case !! "<<endl;
 				exit(1);
 			}
 			if ( count == 2 ) {
@@ -664,7 +703,6 @@ void Application::readTest() {
 		number = findARandomNodeThatIsAlive();
 
 		// Step 4.b Find a non - replica for this key
-		replicas.clear();
 		replicas = mp2[number]->findNodes(it->first);
 		for ( int i = 0; i < par->EN_GPSZ; i++ ) {
 			if ( !mp2[i]->getMemberNode()->bFailed ) {
@@ -731,7 +769,7 @@ void Application::updateTest() {
 	it++;
 	string newValue = "newValue";
 	int number;
-	vector<Node> replicas;
+	ReplicaSet replicas;
 	int replicaIdToFail = TERTIARY;
 	int nodeToFail;
 	bool failedOneNode = false;
@@ -759,12 +797,11 @@ void Application::updateTest() {
 		number = findARandomNodeThatIsAlive();
 
 		// Step 2.b Find the replicas of this key
-		replicas.clear();
 		replicas = mp2[number]->findNodes(it->first);
 		// if quorum replicas are not found then exit
-		if ( replicas.size() < RF-1 ) {
-			log->LOG(&mp2[number]->getMemberNode()->addr, "Could not find at least quorum replicas for this key. Exiting!!! size of replicas vector: %d", replicas.size());
-			cout<<endl<<"Could not find at least quorum replicas for this key. Exiting!!! size of replicas vector: "<<replicas.size()<<endl;
+		if ( mp2[number]->ringSize() < RF ) {
+			log->LOG(&mp2[number]->getMemberNode()->addr, "Could not find at least quorum replicas for this key. Exiting!!! size of the ring: %zu", mp2[number]->ringSize());
+			cout<<endl<<"Could not find at least quorum replicas for this key. Exiting!!! size of the ring: "<<mp2[number]->ringSize()<<endl;
 			exit(1);
 		}
 
@@ -826,11 +863,10 @@ void Application::updateTest() {
 			number = findARandomNodeThatIsAlive();
 
 			// Get the keys replicas
-			replicas.clear();
 			replicas = mp2[number]->findNodes(it->first);
 
 			// Step 3.b. Fail two replicas
-			if ( replicas.size() > 2 ) {
+			if ( mp2[number]->ringSize() >= RF ) {
 				replicaIdToFail = TERTIARY;
 				while ( count != 2 ) {
 					int i = 0;
@@ -906,7 +942,6 @@ void Application::updateTest() {
 		number = findARandomNodeThatIsAlive();
 
 		// Step 4.b Find a non - replica for this key
-		replicas.clear();
 		replicas = mp2[number]->findNodes(it->first);
 		for ( int i = 0; i < par->EN_GPSZ; i++ ) {
 			if ( !mp2[i]->getMemberNode()->bFailed ) {
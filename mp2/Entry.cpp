@@ -8,34 +8,36 @@
 /**
  * constructor
  */
-Entry::Entry(string _value, int _timestamp, ReplicaType _replica){
-	this->delimiter = ":";
-	value = _value;
+Entry::Entry(){
+	timestamp = 0;
+}
+
+/**
+ * constructor
+ */
+Entry::Entry(string _value, int _timestamp){
+	value = std::move(_value);
 	timestamp = _timestamp;
-	replica = _replica;
 }
 
 /**
  * constructor
  *
- * DESCRIPTION: Convert string to get an Entry object
+ * DESCRIPTION: Convert string to get an Entry object.
+ * 				The timestamp is split from the right, so the value may itself
+ * 				contain the delimiter.
  */
-Entry::Entry(string entry){
-	vector<string> tuple;
-	this->delimiter = ":";
-	size_t pos = entry.find(delimiter);
-	size_t start = 0;
-	while (pos != string::npos) {
-		string field = entry.substr(start, pos-start);
-		tuple.push_back(field);
-		start = pos + delimiter.size();
-		pos = entry.find(delimiter, start);
-	}
-	tuple.push_back(entry.substr(start));
+Entry::Entry(string_view entry){
+	size_t tpos = entry.rfind(ENTRY_DELIMITER);
 
-	value = tuple.at(0);
-	timestamp = stoi(tuple.at(1));
-	replica = static_cast<ReplicaType>(stoi(tuple.at(2)));
+	timestamp = 0;
+	if (tpos == string_view::npos) {
+		// not an entry, keep it all as the value
+		value = string(entry);
+		return;
+	}
+	value = string(entry.substr(0, tpos));
+	from_chars(entry.data() + tpos + 1, entry.data() + entry.size(), timestamp);
 }
 
 /**
@@ -43,6 +45,56 @@ Entry::Entry(string entry){
  *
  * DESCRIPTION: Convert the object to a string representation
  */
-string Entry::convertToString() {
-	return value + delimiter + to_string(timestamp) + delimiter + to_string(replica);
+string Entry::convertToString() const {
+	return value + ENTRY_DELIMITER + to_string(timestamp);
+}
+
+/**
+ * FUNCTION NAME: recordSize
+ *
+ * DESCRIPTION: Size of the record of this entry under key in a BULK message
+ */
+size_t Entry::recordSize(string_view key) const {
+	return 3 * sizeof(int) + key.size() + value.size();
+}
+
+/**
+ * FUNCTION NAME: appendRecord
+ *
+ * DESCRIPTION: Appends the record of this entry under key to records
+ */
+void Entry::appendRecord(string& records, string_view key) const {
+	int len = key.size();
+	records.append((const char *)&len, sizeof(int));
+	records.append(key.data(), key.size());
+	len = value.size();
+	records.append((const char *)&len, sizeof(int));
+	records.append(value);
+	records.append((const char *)&timestamp, sizeof(int));
+}
+
+/**
+ * FUNCTION NAME: takeRecord
+ *
+ * DESCRIPTION: Reads the first record of records in place and drops it from records.
+ * 				key and value point into the records.
+ *
+ * RETURNS:
+ * false if records holds no complete record
+ */
+bool Entry::takeRecord(string_view& records, string_view& key, string_view& value, int& timestamp) {
+	int klen, vlen;
+	if (records.size() < 3 * sizeof(int))
+		return false;
+	memcpy(&klen, records.data(), sizeof(int));
+	if (klen < 0 || records.size() < 3 * sizeof(int) + klen)
+		return false;
+	memcpy(&vlen, records.data() + sizeof(int) + klen, sizeof(int));
+	if (vlen < 0 || records.size() < 3 * sizeof(int) + klen + vlen)
+		return false;
+	key = records.substr(sizeof(int), klen);
+	value = records.substr(2 * sizeof(int) + klen, vlen);
+	memcpy(&timestamp, records.data() + 2 * sizeof(int) + klen + vlen, sizeof(int));
+	records.remove_prefix(3 * sizeof(int) + klen + vlen);
+	return true;
 }
@@ -4,22 +4,36 @@
  * DESCRIPTION: Header file Entry class
  **********************************/
 
+#ifndef ENTRY_H_
+#define ENTRY_H_
+
 #include "stdincludes.h"
 #include "Message.h"
 
+// Separates the fields of an entry on the wire
+#define ENTRY_DELIMITER ':'
+
 /**
  * CLASS NAME: Entry
  *
- * DESCRIPTION: This class describes the entry for each key in the DHT
+ * DESCRIPTION: This class describes the entry for each key in the DHT.
+ * 				Entries are stored as they are; the "value:timestamp" text form is
+ * 				only used in read replies. The replica type of a node for the key is
+ * 				not stored, it follows from the ring.
  */
 class Entry{
 public:
 	string value;
 	int timestamp;
-	ReplicaType replica;
-	string delimiter;
 
-	Entry(string entry);
-	Entry(string _value, int _timestamp, ReplicaType _replica);
-	string convertToString();
+	Entry();
+	Entry(string_view entry);
+	Entry(string _value, int _timestamp);
+	string convertToString() const;
+	// record of a BULK message: |key length (4)|key|value length (4)|value|timestamp (4)|
+	size_t recordSize(string_view key) const;
+	void appendRecord(string& records, string_view key) const;
+	static bool takeRecord(string_view& records, string_view& key, string_view& value, int& timestamp);
 };
+
+#endif /* ENTRY_H_ */
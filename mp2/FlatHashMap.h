@@ -0,0 +1,270 @@
+/**********************************
+ * FILE NAME: FlatHashMap.h
+ *
+ * DESCRIPTION: Open addressing hash map with string keys, in the style of a
+ * 				Swiss table: one control byte per slot, probed a group at a time
+ **********************************/
+
+#ifndef FLATHASHMAP_H_
+#define FLATHASHMAP_H_
+
+#include "stdincludes.h"
+#include "Hash.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Slots probed together, one SSE2 register of control bytes
+#define FLAT_GROUP 16
+// Control byte of a slot never used since the last rehash
+#define FLAT_EMPTY ((int8_t)-128)
+// Control byte of an erased slot, probing must go on past it
+#define FLAT_DELETED ((int8_t)-2)
+// A full slot holds the low 7 bits of its key's hash as control byte
+#define FLAT_H2(h) ((int8_t)((h) & 0x7F))
+
+/**
+ * FUNCTION NAME: flatMatch
+ *
+ * DESCRIPTION: Bit i is set for each control byte i of the group at ctrl equal to b
+ */
+inline uint32_t flatMatch(const int8_t *ctrl, int8_t b) {
+#ifdef __SSE2__
+	__m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(b)));
+#else
+	uint32_t mask = 0;
+	for ( int i = 0; i < FLAT_GROUP; i++ ) {
+		if ( ctrl[i] == b ) {
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+#endif
+}
+
+/**
+ * FUNCTION NAME: flatMatchFree
+ *
+ * DESCRIPTION: Bit i is set for each empty or deleted slot i of the group at ctrl
+ */
+inline uint32_t flatMatchFree(const int8_t *ctrl) {
+#ifdef __SSE2__
+	// free control bytes are the negative ones
+	return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+	uint32_t mask = 0;
+	for ( int i = 0; i < FLAT_GROUP; i++ ) {
+		if ( ctrl[i] < 0 ) {
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+#endif
+}
+
+/**
+ * CLASS NAME: FlatHashMap
+ *
+ * DESCRIPTION: Map from string to V with the lookup interface of std::map.
+ * 				Entries live in one flat array, grouped by FLAT_GROUP slots. A key
+ * 				probes whole groups, starting at the group picked by the high bits of
+ * 				its hash, and only compares keys whose control byte matches.
+ * 				Inserting may move every entry; erasing never does.
+ */
+template <class V>
+class FlatHashMap {
+public:
+	typedef pair<string, V> value_type;
+
+	class iterator {
+	public:
+		FlatHashMap *owner;
+		size_t slot;
+		iterator(FlatHashMap *owner, size_t slot): owner(owner), slot(slot) {
+			skip();
+		}
+		value_type& operator *() const { return owner->slots[slot]; }
+		value_type* operator ->() const { return &owner->slots[slot]; }
+		iterator& operator ++() {
+			slot++;
+			skip();
+			return *this;
+		}
+		iterator operator ++(int) {
+			iterator prev = *this;
+			++*this;
+			return prev;
+		}
+		bool operator ==(const iterator& other) const { return slot == other.slot; }
+		bool operator !=(const iterator& other) const { return slot != other.slot; }
+	private:
+		// move on to the next full slot
+		void skip() {
+			while ( slot < owner->ctrl.size() && owner->ctrl[slot] < 0 ) {
+				slot++;
+			}
+		}
+	};
+
+	FlatHashMap(): used(0), tombstones(0), groupMask(0) {}
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, ctrl.size()); }
+	size_t size() const { return used; }
+	bool empty() const { return used == 0; }
+	size_t capacity() const { return ctrl.size(); }
+
+	iterator find(string_view key) {
+		return find(key, hash64(key));
+	}
+
+	/**
+	 * Same as find(key), for a caller that already hashed the key with hash64
+	 */
+	iterator find(string_view key, uint64_t h) {
+		size_t slot = findSlot(key, h);
+		return slot == NOT_FOUND ? end() : iterator(this, slot);
+	}
+
+	size_t count(string_view key) {
+		return findSlot(key, hash64(key)) == NOT_FOUND ? 0 : 1;
+	}
+
+	pair<iterator, bool> emplace(string&& key, V&& value) {
+		uint64_t h = hash64(key);
+		return emplace(std::move(key), std::move(value), h);
+	}
+
+	/**
+	 * Inserts (key, value) if the key is absent, h being hash64 of the key. Returns
+	 * the entry of the key and whether it was inserted.
+	 */
+	pair<iterator, bool> emplace(string&& key, V&& value, uint64_t h) {
+		size_t slot = findSlot(key, h);
+		if ( slot != NOT_FOUND ) {
+			return make_pair(iterator(this, slot), false);
+		}
+		// keep at least one empty slot in 8 so probing stays short
+		if ( (used + tombstones + 1) * 8 > capacity() * 7 ) {
+			rehash();
+		}
+		slot = insertSlot(h, value_type(std::move(key), std::move(value)));
+		return make_pair(iterator(this, slot), true);
+	}
+
+	void erase(iterator it) {
+		size_t group = it.slot - it.slot % FLAT_GROUP;
+		// a group that still has an empty slot never made a probe go past it,
+		// so the slot can become empty again instead of a tombstone
+		if ( flatMatch(&ctrl[group], FLAT_EMPTY) ) {
+			ctrl[it.slot] = FLAT_EMPTY;
+		}
+		else {
+			ctrl[it.slot] = FLAT_DELETED;
+			tombstones++;
+		}
+		// release the memory of the entry
+		slots[it.slot] = value_type();
+		used--;
+	}
+
+	void clear() {
+		ctrl.clear();
+		slots.clear();
+		used = 0;
+		tombstones = 0;
+		groupMask = 0;
+	}
+
+private:
+	static const size_t NOT_FOUND = (size_t)-1;
+	// Control bytes, one per slot
+	vector<int8_t> ctrl;
+	// Entries, only meaningful where the control byte is not negative
+	vector<value_type> slots;
+	// Number of full slots
+	size_t used;
+	// Number of deleted slots
+	size_t tombstones;
+	// Number of groups - 1
+	size_t groupMask;
+
+	/**
+	 * Slot holding key, whose hash is h, or NOT_FOUND
+	 */
+	size_t findSlot(string_view key, uint64_t h) const {
+		size_t group, step, slot;
+		uint32_t mask;
+		if ( ctrl.empty() ) {
+			return NOT_FOUND;
+		}
+		group = (h >> 7) & groupMask;
+		for ( step = 1; ; step++ ) {
+			const int8_t *c = &ctrl[group * FLAT_GROUP];
+			for ( mask = flatMatch(c, FLAT_H2(h)); mask; mask &= mask - 1 ) {
+				slot = group * FLAT_GROUP + __builtin_ctz(mask);
+				if ( slots[slot].first == key ) {
+					return slot;
+				}
+			}
+			// the key would have been placed in this group
+			if ( flatMatch(c, FLAT_EMPTY) ) {
+				return NOT_FOUND;
+			}
+			// triangular steps visit every group once
+			group = (group + step) & groupMask;
+		}
+	}
+
+	/**
+	 * Places entry, whose key is absent and hashes to h, in the first free slot
+	 * of its probe sequence
+	 */
+	size_t insertSlot(uint64_t h, value_type&& entry) {
+		size_t group, step, slot;
+		uint32_t mask;
+		group = (h >> 7) & groupMask;
+		for ( step = 1; ; step++ ) {
+			mask = flatMatchFree(&ctrl[group * FLAT_GROUP]);
+			if ( mask ) {
+				slot = group * FLAT_GROUP + __builtin_ctz(mask);
+				if ( ctrl[slot] == FLAT_DELETED ) {
+					tombstones--;
+				}
+				ctrl[slot] = FLAT_H2(h);
+				slots[slot] = std::move(entry);
+				used++;
+				return slot;
+			}
+			group = (group + step) & groupMask;
+		}
+	}
+
+	/**
+	 * Moves every entry to a new table: twice as large, or the same size when
+	 * at least half of the slots are tombstones
+	 */
+	void rehash() {
+		size_t newCapacity = capacity() ? capacity() : FLAT_GROUP;
+		vector<int8_t> oldCtrl;
+		vector<value_type> oldSlots;
+		size_t i;
+		if ( (used + 1) * 2 > newCapacity ) {
+			newCapacity *= 2;
+		}
+		oldCtrl.swap(ctrl);
+		oldSlots.swap(slots);
+		ctrl.assign(newCapacity, FLAT_EMPTY);
+		slots.resize(newCapacity);
+		used = 0;
+		tombstones = 0;
+		groupMask = newCapacity / FLAT_GROUP - 1;
+		for ( i = 0; i < oldCtrl.size(); i++ ) {
+			if ( oldCtrl[i] >= 0 ) {
+				insertSlot(hash64(oldSlots[i].first), std::move(oldSlots[i]));
+			}
+		}
+	}
+};
+
+#endif /* FLATHASHMAP_H_ */
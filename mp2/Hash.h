@@ -0,0 +1,171 @@
+/**********************************
+ * FILE NAME: Hash.h
+ *
+ * DESCRIPTION: Stable, seeded 64-bit hash (XXH64) used to place keys and
+ * 				nodes on the consistent hashing ring
+ **********************************/
+
+#ifndef HASH_H_
+#define HASH_H_
+
+#include "stdincludes.h"
+
+// Seed of the ring hash, every node must use the same one
+#define HASH_SEED 0x27d4eb2f165667c5ULL
+// Keys hashed side by side by hash64Batch
+#define HASH_LANES 4
+
+static const uint64_t XXH_P1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t XXH_P2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t XXH_P3 = 0x165667B19E3779F9ULL;
+static const uint64_t XXH_P4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t XXH_P5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t xxhRotl(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t xxhRead64(const char *p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline uint32_t xxhRead32(const char *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline uint64_t xxhRound(uint64_t acc, uint64_t input) {
+	acc += input * XXH_P2;
+	acc = xxhRotl(acc, 31);
+	return acc * XXH_P1;
+}
+
+inline uint64_t xxhMerge(uint64_t acc, uint64_t val) {
+	acc ^= xxhRound(0, val);
+	return acc * XXH_P1 + XXH_P4;
+}
+
+/**
+ * CLASS NAME: HashState
+ *
+ * DESCRIPTION: XXH64 state of one key: the four accumulators of the 32 byte stripes
+ */
+class HashState {
+public:
+	uint64_t v[4];
+	HashState(uint64_t seed) {
+		v[0] = seed + XXH_P1 + XXH_P2;
+		v[1] = seed + XXH_P2;
+		v[2] = seed;
+		v[3] = seed - XXH_P1;
+	}
+	void stripe(const char *p) {
+		v[0] = xxhRound(v[0], xxhRead64(p));
+		v[1] = xxhRound(v[1], xxhRead64(p + 8));
+		v[2] = xxhRound(v[2], xxhRead64(p + 16));
+		v[3] = xxhRound(v[3], xxhRead64(p + 24));
+	}
+	/**
+	 * Folds the stripes processed so far and the remaining tail [p, end) of a
+	 * key of len bytes into its hash
+	 */
+	uint64_t finish(const char *p, const char *end, size_t len, uint64_t seed) const {
+		uint64_t h;
+		if ( len >= 32 ) {
+			h = xxhRotl(v[0], 1) + xxhRotl(v[1], 7) + xxhRotl(v[2], 12) + xxhRotl(v[3], 18);
+			h = xxhMerge(h, v[0]);
+			h = xxhMerge(h, v[1]);
+			h = xxhMerge(h, v[2]);
+			h = xxhMerge(h, v[3]);
+		}
+		else {
+			h = seed + XXH_P5;
+		}
+		h += len;
+		for ( ; p + 8 <= end; p += 8 ) {
+			h ^= xxhRound(0, xxhRead64(p));
+			h = xxhRotl(h, 27) * XXH_P1 + XXH_P4;
+		}
+		if ( p + 4 <= end ) {
+			h ^= (uint64_t)xxhRead32(p) * XXH_P1;
+			h = xxhRotl(h, 23) * XXH_P2 + XXH_P3;
+			p += 4;
+		}
+		for ( ; p < end; p++ ) {
+			h ^= (unsigned char)*p * XXH_P5;
+			h = xxhRotl(h, 11) * XXH_P1;
+		}
+		h ^= h >> 33;
+		h *= XXH_P2;
+		h ^= h >> 29;
+		h *= XXH_P3;
+		h ^= h >> 32;
+		return h;
+	}
+};
+
+/**
+ * FUNCTION NAME: hash64
+ *
+ * DESCRIPTION: XXH64 of len bytes at data. The result only depends on the bytes
+ * 				and the seed, so placement is the same on every platform.
+ */
+inline uint64_t hash64(const char *data, size_t len, uint64_t seed = HASH_SEED) {
+	HashState state(seed);
+	const char *p = data, *end = data + len;
+	for ( ; p + 32 <= end; p += 32 ) {
+		state.stripe(p);
+	}
+	return state.finish(p, end, len, seed);
+}
+
+inline uint64_t hash64(string_view key, uint64_t seed = HASH_SEED) {
+	return hash64(key.data(), key.size(), seed);
+}
+
+/**
+ * FUNCTION NAME: hash64Batch
+ *
+ * DESCRIPTION: Hashes count keys into out, same results as hash64.
+ * 				Keys are taken HASH_LANES at a time and their 32 byte stripes are
+ * 				processed lane by lane, so the independent multiply chains of the
+ * 				lanes overlap instead of waiting on each other. This is scalar code
+ * 				relying on instruction-level parallelism, not SIMD: XXH64 needs full
+ * 				64-bit multiplies, which SSE2 and AVX2 do not provide.
+ * 				Used where many keys are placed at once, i.e. by the stabilization
+ * 				protocol; a single request hashes its one key with hash64.
+ */
+inline void hash64Batch(const string_view *keys, size_t count, uint64_t *out, uint64_t seed = HASH_SEED) {
+	size_t i, lane, s, shared;
+	for ( i = 0; i + HASH_LANES <= count; i += HASH_LANES ) {
+		HashState lanes[HASH_LANES] = { HashState(seed), HashState(seed), HashState(seed), HashState(seed) };
+		// stripes all lanes have
+		shared = keys[i].size();
+		for ( lane = 1; lane < HASH_LANES; lane++ ) {
+			shared = min(shared, keys[i + lane].size());
+		}
+		shared /= 32;
+		for ( s = 0; s < shared; s++ ) {
+			for ( lane = 0; lane < HASH_LANES; lane++ ) {
+				lanes[lane].stripe(keys[i + lane].data() + s * 32);
+			}
+		}
+		// the rest of each key on its own
+		for ( lane = 0; lane < HASH_LANES; lane++ ) {
+			const char *p = keys[i + lane].data() + shared * 32;
+			const char *end = keys[i + lane].data() + keys[i + lane].size();
+			for ( ; p + 32 <= end; p += 32 ) {
+				lanes[lane].stripe(p);
+			}
+			out[i + lane] = lanes[lane].finish(p, end, keys[i + lane].size(), seed);
+		}
+	}
+	for ( ; i < count; i++ ) {
+		out[i] = hash64(keys[i], seed);
+	}
+}
+
+#endif /* HASH_H_ */
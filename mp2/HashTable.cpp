@@ -6,10 +6,44 @@
 
 #include "HashTable.h"
 
-HashTable::HashTable() {}
+HashTable::HashTable() {
+	entries = 0;
+}
 
 HashTable::~HashTable() {}
 
+/**
+ * FUNCTION NAME: findIn
+ *
+ * DESCRIPTION: Looks key up in store, h being hash64 of the key. Only the flat table
+ * 				hashes its keys, so the map ignores h.
+ */
+HashTable::iterator HashTable::findIn(Store& store, string_view key, uint64_t h) {
+#ifdef HASHTABLE_MAP
+	return store.find(key);
+#else
+	return store.find(key, h);
+#endif
+}
+
+/**
+ * FUNCTION NAME: insertIn
+ *
+ * DESCRIPTION: Inserts (key, value) into store if the key is absent, h being hash64
+ * 				of the key
+ *
+ * RETURNS:
+ * true if inserted
+ * false if the key was already there
+ */
+bool HashTable::insertIn(Store& store, string&& key, Entry&& value, uint64_t h) {
+#ifdef HASHTABLE_MAP
+	return store.emplace(std::move(key), std::move(value)).second;
+#else
+	return store.emplace(std::move(key), std::move(value), h).second;
+#endif
+}
+
 /**
  * FUNCTION NAME: create
  *
@@ -19,31 +53,57 @@ HashTable::~HashTable() {}
  * true on SUCCESS
  * false in FAILURE
  */
-bool HashTable::create(string key, string value) {
-	hashTable.emplace(key, value);
+bool HashTable::create(string&& key, Entry&& value) {
+	uint64_t h = hash64(key);
+	if ( insertIn(hashTable[partitionOf(h)], std::move(key), std::move(value), h) ) {
+		entries++;
+	}
 	return true;
 }
 
 /**
- * FUNCTION NAME: read
+ * FUNCTION NAME: find
  *
- * DESCRIPTION: This function searches for the key in the hash table
+ * DESCRIPTION: This function searches for the key in the hash table without copying
  *
  * RETURNS:
- * string value if found
+ * the entry of the key if found, owned by the table
  * else it returns a NULL
  */
-string HashTable::read(string key) {
-	map<string, string>::iterator search;
+const Entry* HashTable::find(string_view key) {
+	uint64_t h = hash64(key);
+	Store& store = hashTable[partitionOf(h)];
+	iterator search = findIn(store, key, h);
+	if ( search != store.end() ) {
+		// Value found
+		return &search->second;
+	}
+	// Value not found
+	return NULL;
+}
 
-	search = hashTable.find(key);
-	if ( search != hashTable.end() ) {
+/**
+ * FUNCTION NAME: read
+ *
+ * DESCRIPTION: This function searches for the key in the hash table and copies
+ * 				its entry into value, reusing the memory value already holds
+ *
+ * RETURNS:
+ * true if found
+ * false otherwise
+ */
+bool HashTable::read(string_view key, Entry& value) {
+	uint64_t h = hash64(key);
+	Store& store = hashTable[partitionOf(h)];
+	iterator search = findIn(store, key, h);
+	if ( search != store.end() ) {
 		// Value found
-		return search->second;
+		value = search->second;
+		return true;
 	}
 	else {
 		// Value not found
-		return "";
+		return false;
 	}
 }
 
@@ -57,20 +117,48 @@ string HashTable::read(string key) {
  * true on SUCCESS
  * false on FAILURE
  */
-bool HashTable::update(string key, string newValue) {
-	map<string, string>::iterator update;
-
-	if (read(key).empty()) {
+bool HashTable::update(string_view key, Entry&& newValue) {
+	uint64_t h = hash64(key);
+	Store& store = hashTable[partitionOf(h)];
+	iterator update = findIn(store, key, h);
+	if (update == store.end()) {
 		// Key not found
 		return false;
 	}
 	// Key found
-	//update = hashTable.at(key) = newValue;
-	hashTable.at(key) = newValue;
+	update->second = std::move(newValue);
 	// Update successful
 	return true;
 }
 
+/**
+ * FUNCTION NAME: merge
+ *
+ * DESCRIPTION: This function inserts the entry of key, or replaces the stored one
+ * 				unless the stored one is newer
+ *
+ * RETURNS:
+ * true if the entry was stored
+ * false if a newer entry was kept
+ */
+bool HashTable::merge(string_view key, Entry&& value) {
+	uint64_t h = hash64(key);
+	Store& store = hashTable[partitionOf(h)];
+	iterator search = findIn(store, key, h);
+	if (search == store.end()) {
+		// New key
+		insertIn(store, string(key), std::move(value), h);
+		entries++;
+		return true;
+	}
+	if (value.timestamp < search->second.timestamp) {
+		// Keep the newer entry
+		return false;
+	}
+	search->second = std::move(value);
+	return true;
+}
+
 /**
  * FUNCTION NAME: deleteKey
  *
@@ -80,18 +168,16 @@ bool HashTable::update(string key, string newValue) {
  * true on SUCCESS
  * false on FAILURE
  */
-bool HashTable::deleteKey(string key) {
-	uint eraseCount = 0;
-
-	if (read(key).empty()) {
+bool HashTable::deleteKey(string_view key) {
+	uint64_t h = hash64(key);
+	Store& store = hashTable[partitionOf(h)];
+	iterator search = findIn(store, key, h);
+	if (search == store.end()) {
 		// Key not found
 		return false;
 	}
-	eraseCount = hashTable.erase(key);
-	if ( eraseCount < 1 ) {
-		// Could not erase
-		return false;
-	}
+	store.erase(search);
+	entries--;
 	// Delete was successful
 	return true;
 }
@@ -106,7 +192,7 @@ bool HashTable::deleteKey(string key) {
  * false otherwise
  */
 bool HashTable::isEmpty() {
-	return hashTable.empty();
+	return entries == 0;
 }
 
 /**
@@ -118,7 +204,7 @@ bool HashTable::isEmpty() {
  * size of the table as unit
  */
 unsigned long HashTable::currentSize() {
-	return (unsigned  long)hashTable.size();
+	return entries;
 }
 
 /**
@@ -127,7 +213,10 @@ unsigned long HashTable::currentSize() {
  * DESCRIPTION: Clear all contents from the hash table
  */
 void HashTable::clear() {
-	hashTable.clear();
+	for ( size_t p = 0; p < HT_PARTITIONS; p++ ) {
+		hashTable[p].clear();
+	}
+	entries = 0;
 }
 
 /**
@@ -138,7 +227,9 @@ void HashTable::clear() {
  * RETURNS:
  * unsigned long count (Should be always 1)
  */
-unsigned long HashTable::count(string key) {
-	return (unsigned long) hashTable.count(key);
+unsigned long HashTable::count(string_view key) {
+	uint64_t h = hash64(key);
+	Store& store = hashTable[partitionOf(h)];
+	return findIn(store, key, h) == store.end() ? 0 : 1;
 }
 
@@ -13,27 +13,57 @@
 #include "stdincludes.h"
 #include "common.h"
 #include "Entry.h"
+#include "FlatHashMap.h"
+#include "Hash.h"
+
+// The table is split in 2^HT_PARTITION_BITS partitions by the top bits of the ring
+// position of each key
+#define HT_PARTITION_BITS 8
+#define HT_PARTITIONS (1 << HT_PARTITION_BITS)
 
 /**
  * CLASS NAME: HashTable
  *
- * DESCRIPTION: This class is a wrapper to the map provided by C++ STL.
+ * DESCRIPTION: This class is a wrapper to the local key value store: a flat open
+ * 				addressing table by default, or the map provided by C++ STL when
+ * 				built with make HASHTABLE=MAP.
+ * 				Keys are placed with the ring hash, so each partition holds the keys of
+ * 				one range of the ring and can be visited on its own.
  *
  */
 class HashTable {
 public:
-	map<string, string> hashTable;
+#ifdef HASHTABLE_MAP
+	// less<> lets lookups take a string_view without building a string
+	typedef map<string, Entry, less<>> Store;
+#else
+	typedef FlatHashMap<Entry> Store;
+#endif
+	typedef Store::iterator iterator;
+	Store hashTable[HT_PARTITIONS];
+	// number of entries over all partitions
+	unsigned long entries;
 //public:
 	HashTable();
-	bool create(string key, string value);
-	string read(string key);
-	bool update(string key, string newValue);
-	bool deleteKey(string key);
+	static size_t partitionOf(uint64_t pos) { return pos >> (64 - HT_PARTITION_BITS); }
+	Store& partition(size_t p) { return hashTable[p]; }
+	// keys and entries are moved into the table
+	bool create(string&& key, Entry&& value);
+	// borrowed pointer to the entry of key, valid until the next create
+	const Entry* find(string_view key);
+	bool read(string_view key, Entry& value);
+	bool update(string_view key, Entry&& newValue);
+	bool merge(string_view key, Entry&& value);
+	bool deleteKey(string_view key);
 	bool isEmpty();
 	unsigned long currentSize();
 	void clear();
-	unsigned long count(string key);
+	unsigned long count(string_view key);
 	virtual ~HashTable();
+private:
+	// lookups and inserts reusing the hash that picked the partition
+	static iterator findIn(Store& store, string_view key, uint64_t h);
+	static bool insertIn(Store& store, string&& key, Entry&& value, uint64_t h);
 };
 
 #endif /* HASHTABLE_H_ */
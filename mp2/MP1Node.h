@@ -21,6 +21,24 @@
 #define TREMOVE 20
 #define TFAIL 5
 #define gossip_nodes 3
+// every FULL_SYNC_PERIOD-th gossip carries the whole list, the others only the
+// entries that changed since the previous gossip (1 = always send everything)
+#define FULL_SYNC_PERIOD 10
+// SWIM failure detector (MP1_PROTOCOL: SWIM), all times in ticks
+#define SWIM_PERIOD 6				// one probe is started every period
+#define SWIM_PING_TIMEOUT 2			// wait for a direct ack before asking others
+#define SWIM_K 3					// members asked to probe indirectly
+#define SWIM_SUSPECT_TIMEOUT 18		// suspicion not refuted by then is a failure
+#define SWIM_PIGGYBACK 6			// membership entries carried by each probe
+
+/**
+ * SWIM verdict carried by a piggybacked entry, in the byte after its address
+ */
+enum SwimState{
+    SWIM_ALIVE,
+    SWIM_SUSPECT,
+    SWIM_CONFIRM
+};
 
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
@@ -33,6 +51,9 @@ enum MsgTypes{
     JOINREQ,
     JOINREP,
     GOSSIP,
+    PING,
+    PINGREQ,
+    ACK,
     DUMMYLASTMSGTYPE
 };
 
@@ -57,6 +78,24 @@ private:
 	Params *par;
 	Member *memberNode;
 	char NULLADDR[6];
+	// number of gossip rounds sent so far
+	long gossipRound;
+	// local time of the last gossip round
+	long lastGossip;
+	// SWIM: sequence number, target id (-1 if none) and start of the current probe
+	long probeSeq;
+	int probeTarget;
+	long probeStart;
+	bool probeIndirect;
+	// SWIM: randomized round-robin order of probe targets
+	vector<int> probeOrder;
+	size_t probeCursor;
+	// SWIM: suspected node ids and the time they were suspected
+	map<int, long> suspects;
+	// SWIM: failed node ids and their last heartbeat, carried by the confirm records
+	map<int, long> confirmed;
+	// SWIM: where the next piggyback starts in the membership list
+	size_t piggyCursor;
 
 public:
 	MP1Node(Member *, Params *, EmulNet *, Log *, Address *);
@@ -81,17 +120,33 @@ public:
 
     //helper functions
     void addr2Entry(MemberListEntry& entry, Address addr, long heartbeat,long local_time);
-    //void entry2Addr(MemberListEntry& entry, Address addr, long heartbeat, long timestamp);
+    void entry2Addr(MemberListEntry& entry, Address& addr);
     void entry2Msg();
     void msg2var(char* addr_ptr, int& id, short& port, long& heartbeat);
 
+    int findMember (int id);
+    void addMember (MemberListEntry& entry);
+    void removeMember (size_t pos);
+    void failMember (size_t pos);
+
     void handle_request (char* data, int size);
     void handle_reply  (char* data, int size);
     void handle_gossip_in  (char* data, int size);
+    void merge_entries (char* msg_ptr, long entries);
 
+    char* build_list (int no, MsgTypes type, long since, long& msg_size);
     void send_list (Address * to_addr, int no, MsgTypes type);
     void gossip_out ();
 
+    void handle_ping (char* data, int size);
+    void handle_pingreq (char* data, int size);
+    void handle_ack (char* data, int size);
+    char* build_swim (MsgTypes type, long seq, Address* subject, Address* origin, long& msg_size);
+    void send_swim (Address* to_addr, MsgTypes type, long seq, Address* subject, Address* origin);
+    void swim2var (char* data, int size, long& seq, Address& subject, Address& origin, Address& sender);
+    int next_probe_target ();
+    void swim_ops ();
+
     void printML();
 };
 
@@ -15,6 +15,8 @@ MP2Node::MP2Node(Member *memberNode, Params *par, EmulNet * emulNet, Log * log,
 	this->log = log;
 	ht = new HashTable();
 	this->memberNode->addr = *address;
+	this->ring = Ring::intern(vector<Node>());
+	this->ringEpoch = -1;
 }
 
 /**
@@ -38,25 +40,54 @@ void MP2Node::updateRing() {
 	/*
 	 * Implement this. Parts of it are already implemented
 	 */
-	vector<Node> curMemList;
+	vector<Node> curMemList, points;
+	vector<MemberEvent> changes;
+	// keep the ring being replaced for the stabilization protocol
+	shared_ptr<const Ring> old_ring = ring;
 	bool change = false;
+	int v;
 
-	/*
-	 *  Step 1. Get the current membership list from Membership Protocol / MP1
-	 */
-	curMemList = getMembershipList();
+	//nothing to do if the membership has not changed since the ring was built
+	if (ringEpoch == memberNode->epoch)
+		return;
 
-	/*
-	 * Step 2: Construct the ring
-	 */
-	// Sort the list based on the hashCode
-	sort(curMemList.begin(), curMemList.end());
-	//update the ring if needed by comparing ring with curMemList
-	// Compare each entry if necessary
-	if (curMemList.size() != ring.size()){
-		change = true;
-		//copy over new data
-		ring = curMemList;
+	if (ringEpoch >= 0 && memberNode->eventsSince(ringEpoch, changes)){
+		/*
+		 * Step 1+2: Apply the membership changes to a copy of the ring
+		 */
+		curMemList = ring->nodes;
+		change = applyMemberEvents(curMemList, changes);
+		if (change){
+			ring = Ring::intern(std::move(curMemList));
+		}
+	}
+	else{
+		/*
+		 *  Step 1. Get the current membership list from Membership Protocol / MP1
+		 */
+		curMemList = getMembershipList();
+
+		/*
+		 * Step 2: Construct the ring
+		 */
+		// Place VNODES virtual nodes per member and sort them based on the hashCode
+		for (auto& member : curMemList){
+			for (v = 0; v < par->VNODES; v++)
+				points.emplace_back(Node(member.nodeAddress, v));
+		}
+		sort(points.begin(), points.end());
+		//share the snapshot of any node with the same view, the ring changed
+		//if that is not the one we already hold
+		shared_ptr<const Ring> new_ring = Ring::intern(std::move(points));
+		change = (new_ring != ring);
+		ring = new_ring;
+	}
+	ringEpoch = memberNode->epoch;
+	//replica sets looked up on the old ring are stale, and so may be the targets
+	//of the bulk transfers under way
+	if (change){
+		replicaCache.clear();
+		retargetTransfers(*old_ring);
 	}
 
 	/*
@@ -64,7 +95,7 @@ void MP2Node::updateRing() {
 	 */
 	// Run stabilization protocol
 	if (change && (!ht->isEmpty())){
-		stabilizationProtocol();
+		stabilizationProtocol(*old_ring);
 	}
 }
 
@@ -95,6 +126,50 @@ vector<Node> MP2Node::getMembershipList() {
 	return curMemList;
 }
 
+/**
+ * FUNCTION NAME: applyMemberEvents
+ *
+ * DESCRIPTION: Applies membership changes to the sorted nodes of a ring: a join
+ * 				inserts the member's virtual nodes at their hash positions, a failure
+ * 				or removal takes them out.
+ *
+ * RETURNS:
+ * true if the ring changed
+ */
+bool MP2Node::applyMemberEvents(vector<Node>& nodes, vector<MemberEvent>& changes) {
+	//local variables
+	vector<MemberEvent>::iterator ev_it;
+	vector<Node>::iterator ring_it;
+	Address addr;
+	bool change = false;
+	int v;
+
+	for (ev_it = changes.begin(); ev_it != changes.end(); ev_it++){
+		memcpy(&addr.addr[0], &ev_it->id, sizeof(int));
+		memcpy(&addr.addr[4], &ev_it->port, sizeof(short));
+		for (v = 0; v < par->VNODES; v++){
+			Node node(addr, v);
+			//find the node among the ones with the same hash code
+			ring_it = lower_bound(nodes.begin(), nodes.end(), node);
+			while (ring_it != nodes.end() && ring_it->nodeHashCode == node.nodeHashCode
+				&& !(ring_it->nodeAddress == addr)){
+				ring_it++;
+			}
+			bool present = (ring_it != nodes.end() && ring_it->nodeAddress == addr);
+
+			if (ev_it->type == MEMBER_JOIN && !present){
+				nodes.insert(ring_it, node);
+				change = true;
+			}
+			else if (ev_it->type != MEMBER_JOIN && present){
+				nodes.erase(ring_it);
+				change = true;
+			}
+		}
+	}
+	return change;
+}
+
 /**
  * FUNCTION NAME: hashFunction
  *
@@ -102,12 +177,10 @@ vector<Node> MP2Node::getMembershipList() {
  * 				HASH FUNCTION USED FOR CONSISTENT HASHING
  *
  * RETURNS:
- * size_t position on the ring
+ * uint64_t position on the ring
  */
-size_t MP2Node::hashFunction(string key) {
-	std::hash<string> hashFunc;
-	size_t ret = hashFunc(key);
-	return ret%RING_SIZE;
+uint64_t MP2Node::hashFunction(string_view key) {
+	return hash64(key);
 }
 
 /**
@@ -124,7 +197,7 @@ void MP2Node::clientCreate(string key, string value) {
 	 * IMPLELENTED
 	 */
 	 //local variables
-	 vector <Node> r_nodes;
+	 ReplicaSet r_nodes;
 	 vector <Node> :: iterator ring_it;
 	 //Create a create message to be sent to the servers
 	 Message oMessage = Message (g_transID++, memberNode->addr,
@@ -135,9 +208,8 @@ void MP2Node::clientCreate(string key, string value) {
 	 r_nodes = findNodes(key);
 	 //add message to archives
 	 archiveAdd(oMessage);
-	 //send a message to all the replicas
-	 for (auto& it : r_nodes)
-	 	emulNet->ENsend (&memberNode->addr, &it.nodeAddress, oMessage.toString() );
+	 //send one shared copy of the message to all the replicas
+	 multicastMessage(r_nodes, oMessage);
 }
 
 
@@ -155,7 +227,7 @@ void MP2Node::clientRead(string key){
 	 * Implement this
 	 */
 	 //local variables
-	 vector <Node> r_nodes;
+	 ReplicaSet r_nodes;
 	 vector <Node> :: iterator ring_it;
 	 //Create a create message to be sent to the servers
 	 Message oMessage = Message (g_transID++, memberNode->addr,
@@ -166,9 +238,8 @@ void MP2Node::clientRead(string key){
 	 r_nodes = findNodes(key);
 	 //add message to archives
 	 archiveAdd(oMessage);
-	 //send a message to all the replicas
-	 for (auto& it : r_nodes)
-		emulNet->ENsend (&memberNode->addr, &it.nodeAddress, oMessage.toString() );
+	 //send one shared copy of the message to all the replicas
+	 multicastMessage(r_nodes, oMessage);
 
 }
 
@@ -186,7 +257,7 @@ void MP2Node::clientUpdate(string key, string value){
 	 * Implement this
 	 */
 	 //local variables
-	 vector <Node> r_nodes;
+	 ReplicaSet r_nodes;
 	 vector <Node> :: iterator ring_it;
 	 //Create an update message to be sent to the replicas
 	 Message oMessage = Message (g_transID++, memberNode->addr,
@@ -195,11 +266,10 @@ void MP2Node::clientUpdate(string key, string value){
 	 updateRing();
 	 //find the replicas of this key
 	 r_nodes = findNodes(key);
-	 //send a message to all the replicas
 	 //add message to archives
 	 archiveAdd(oMessage);
-	 for (auto& it : r_nodes)
-	 	emulNet->ENsend (&memberNode->addr, &it.nodeAddress, oMessage.toString() );
+	 //send one shared copy of the message to all the replicas
+	 multicastMessage(r_nodes, oMessage);
 }
 
 /**
@@ -216,7 +286,7 @@ void MP2Node::clientDelete(string key){
 	 * IMPLELENTED
 	 */
 	 //local variables
-	 vector <Node> r_nodes;
+	 ReplicaSet r_nodes;
 	 vector <Node> :: iterator ring_it;
 	 //Create a delete message to be sent to the servers
 	 Message oMessage = Message (g_transID++, memberNode->addr,
@@ -227,9 +297,8 @@ void MP2Node::clientDelete(string key){
 	 r_nodes = findNodes(key);
 	 //add message to archives
 	 archiveAdd(oMessage);
-	 //send a message to all the replicas
-	 for (auto& it : r_nodes)
-	 	emulNet->ENsend (&memberNode->addr, &it.nodeAddress, oMessage.toString() );
+	 //send one shared copy of the message to all the replicas
+	 multicastMessage(r_nodes, oMessage);
 }
 
 /**
@@ -240,15 +309,15 @@ void MP2Node::clientDelete(string key){
  * 			   	1) Inserts key value into the local hash table
  * 			   	2) Return true or false based on success or failure
  */
-bool MP2Node::createKeyValue(string key, string value, ReplicaType replica) {
+bool MP2Node::createKeyValue(string_view key, string_view value) {
 	/*
 	 * Implement this
 	 */
-	// Insert key, value, replicaType into the hash table
-	//make a key value entry using the value and replica type
-	Entry new_entry(value, par->getcurrtime(), replica);
-	//create the entry in the hash table as a string
-	return ht->create(key, new_entry.convertToString());
+	// Insert key, value into the hash table
+	//make a key value entry using the value and the current time
+	Entry new_entry(string(value), par->getcurrtime());
+	//create the entry in the hash table
+	return ht->create(string(key), std::move(new_entry));
 }
 
 /**
@@ -257,14 +326,15 @@ bool MP2Node::createKeyValue(string key, string value, ReplicaType replica) {
  * DESCRIPTION: Server side READ API
  * 			    This function does the following:
  * 			    1) Read key from local hash table
- * 			    2) Return value
+ * 			    2) Return its entry, or NULL if the key does not exist.
+ * 			       The entry is borrowed from the table, no copy is made
  */
-string MP2Node::readKey(string key) {
+const Entry* MP2Node::readKey(string_view key) {
 	/*
 	 * Implement this
 	 */
 	// Read key from local hash table and return value
-	return ht->read(key);
+	return ht->find(key);
 }
 
 /**
@@ -275,15 +345,15 @@ string MP2Node::readKey(string key) {
  * 				1) Update the key to the new value in the local hash table
  * 				2) Return true or false based on success or failure
  */
-bool MP2Node::updateKeyValue(string key, string value, ReplicaType replica) {
+bool MP2Node::updateKeyValue(string_view key, string_view value) {
 	/*
 	 * Implement this
 	 */
 	// Update key in local hash table and return true or false
 	//get updated entry
-	Entry updated_entry (value, par->getcurrtime(), replica);
+	Entry updated_entry (string(value), par->getcurrtime());
 	//update the hash table entry
-	return ht->update (key, updated_entry.convertToString());
+	return ht->update (key, std::move(updated_entry));
 }
 
 /**
@@ -294,7 +364,7 @@ bool MP2Node::updateKeyValue(string key, string value, ReplicaType replica) {
  * 				1) Delete the key from the local hash table
  * 				2) Return true or false based on success or failure
  */
-bool MP2Node::deletekey(string key) {
+bool MP2Node::deletekey(string_view key) {
 	/*
 	 * Implement this
 	 */
@@ -330,15 +400,16 @@ void MP2Node::checkMessages() {
 		size = memberNode->mp2q.front().size;
 		memberNode->mp2q.pop();
 
-		string message(data, data + size);
-
 		/*
 		 * Handle the message types here
 		 */
-		 //create messagge var called imsg
-		 Message imsg(message);
-		 //call message handler function
-		 switchBoard(imsg);
+		 //parse the message in place, in whichever wire format it was sent
+		 MessageView imsg(data, size);
+		 //call message handler function, dropping malformed frames
+		 if (imsg.valid)
+			 switchBoard(imsg);
+		 // the buffer was allocated by the sender and handed over by EmulNet
+		 emulNet->ENfree(data);
 
 	}
 
@@ -348,6 +419,8 @@ void MP2Node::checkMessages() {
 	 */
 	 //sort out archived messages : checks for quorum
 	 sortArchives();
+	 //go on with the bulk transfers of the stabilization protocol
+	 flushTransfers();
 }
 
 
@@ -367,37 +440,37 @@ void MP2Node::checkMessages() {
  *
  *Functionality : Creates a Key Value pair & logs a failure or success
  */
-void MP2Node ::handle_create( Message& imsg){
+void MP2Node ::handle_create( MessageView& imsg){
 	//local variables
 	ReplicaType my_replica;
-	vector <Node> replica_vect = findNodes(imsg.key);
+	const ReplicaLookup& lookup = lookupReplicas(hashFunction(imsg.key));
+	ReplicaSet replica_vect = lookup.nodes;
 	bool status = false;
 
 	//get replica type of this node for this key
-	my_replica = getReplicaType(imsg.key, memberNode->addr);
+	my_replica = lookup.myRole;
 	//if unknoown, send to correct replicas
 	if (my_replica == UNKNOWN){
-		cout << "RESENDING, STALE MEMBERSHIP LIST"<<endl;
-		emulNet->ENsend(&memberNode->addr, &replica_vect[0].nodeAddress,
-			imsg.toString());
+		if (ring->memberCount >= RF)
+			emulNet->ENsend(&memberNode->addr, &replica_vect[0].nodeAddress,
+				(char *)imsg.data, imsg.size);
 		return;
 	}
 
 	//Perfrom operation and send a reply to the coordinator
 	//perofrm op & log if success or failure
-	status = createKeyValue(imsg.key, imsg.value, my_replica);
+	status = createKeyValue(imsg.key, imsg.value);
 	if (status){
 		log->logCreateSuccess(&memberNode->addr, false,
-		 				imsg.transID, imsg.key, imsg.value);
+		 				imsg.transID, string(imsg.key), string(imsg.value));
 	}
 	else{
 		log->logCreateFail(&memberNode->addr, false,
-		 				imsg.transID, imsg.key, imsg.value);
+		 				imsg.transID, string(imsg.key), string(imsg.value));
 	}
 	//send success to coord
 	Message reply(imsg.transID, memberNode->addr, REPLY, status);
-	emulNet->ENsend(&memberNode->addr, &imsg.fromAddr,
-	 					reply.toString());
+	sendMessage(&imsg.fromAddr, reply);
 }
 
 
@@ -413,24 +486,21 @@ void MP2Node ::handle_create( Message& imsg){
  *Functionality : Reads and returns the value of a given key
  *					logs a failure or success
  */
-void MP2Node ::handle_read( Message& imsg){
+void MP2Node ::handle_read( MessageView& imsg){
 	//local variables
-	string oValue;
-	oValue = readKey(imsg.key);
+	const Entry* oEntry = readKey(imsg.key);
 	//Check if key exists
-	if (oValue == ""){
+	if (oEntry == NULL){
 		log->logReadFail(&memberNode->addr, false,
-		 				imsg.transID, imsg.key);
+		 				imsg.transID, string(imsg.key));
 	}
 	else{
-		//Get the entry, log it then send to coordinator
-		Entry oEntry(oValue);
+		//log the entry then send it to coordinator
 		log->logReadSuccess(&memberNode->addr, false,
-		 				imsg.transID, imsg.key, oEntry.value);
+		 				imsg.transID, string(imsg.key), oEntry->value);
 		//send success to coord
-		Message read_reply(imsg.transID, memberNode->addr, oValue);
-		emulNet->ENsend(&memberNode->addr, &imsg.fromAddr,
-		 					read_reply.toString());
+		Message read_reply(imsg.transID, memberNode->addr, oEntry->convertToString());
+		sendMessage(&imsg.fromAddr, read_reply);
 	}
 }
 
@@ -446,56 +516,39 @@ void MP2Node ::handle_read( Message& imsg){
  *
  *Functionality : Updates the value of a given key if it exists
  *					logs a failure or success
- *					Also processes update messages from primary replicas
+ *					Also processes and acks update messages from primary replicas
  */
-void MP2Node ::handle_update( Message& imsg){
+void MP2Node ::handle_update( MessageView& imsg){
 	//local variables
-	ReplicaType my_replica;
-	vector <Node> replica_vect = findNodes(imsg.key);
 	bool status = false;
-	bool flag = false;
 
-	//get replica type
-	my_replica = getReplicaType(imsg.key, memberNode->addr);
 	//if unknoown, it is from coordinator
 		if (imsg.replica == UNKNOWN){
 			//Update if key exists
-			if (ht->hashTable.find(imsg.key) != ht->hashTable.end()){
-				status = updateKeyValue(imsg.key, imsg.value, my_replica);
-			}
+			status = updateKeyValue(imsg.key, imsg.value);
 			//log & send value on successful update
 			if (status){
 				log->logUpdateSuccess(&memberNode->addr, false, imsg.transID,
-					imsg.key, imsg.value);
+					string(imsg.key), string(imsg.value));
 				Message reply(imsg.transID, memberNode->addr, REPLY, status);
-				emulNet->ENsend(&memberNode->addr, &imsg.fromAddr,
-				 					reply.toString());
+				sendMessage(&imsg.fromAddr, reply);
 			}
 			//log faulure
 			else{
 				//key does not exist: failed update
 				log->logUpdateFail(&memberNode->addr, false,
-					imsg.transID,imsg.key, imsg.value);
+					imsg.transID,string(imsg.key), string(imsg.value));
 			}
 		}
-		//It came from one of the primary replicas
+		//It is a copy from another replica
 		else{
-			//Add to vector list if not already there
-			for (auto& it : haveReplicasOf){
-				//flag if you find it
-				if (imsg.fromAddr == it.nodeAddress)
-					flag = true;
-			}
-			if (!flag)
-				haveReplicasOf.push_back(imsg.fromAddr);
-
-			//if it does not exist, create it, else, update it
-			if (ht->hashTable.find(imsg.key) == ht->hashTable.end()){
-				createKeyValue(imsg.key, imsg.value, imsg.replica);
-			}
-			else{
-				updateKeyValue(imsg.key, imsg.value, my_replica);
+			//update it, or create it if it does not exist
+			if (!updateKeyValue(imsg.key, imsg.value)){
+				createKeyValue(imsg.key, imsg.value);
 			}
+			//ack the copy to the sender
+			Message reply(imsg.transID, memberNode->addr, REPLY, true);
+			sendMessage(&imsg.fromAddr, reply);
 		}
 }
 
@@ -512,19 +565,20 @@ void MP2Node ::handle_update( Message& imsg){
  *Functionality : Deletes a given key-value entry if it exists
  *					logs a failure or success
  */
-void MP2Node ::handle_delete( Message& imsg){
+void MP2Node ::handle_delete( MessageView& imsg){
 	//local variables
 	ReplicaType my_replica;
-	vector <Node> replica_vect = findNodes(imsg.key);
+	const ReplicaLookup& lookup = lookupReplicas(hashFunction(imsg.key));
+	ReplicaSet replica_vect = lookup.nodes;
 	bool status = false;
 
 	//get replica type of this node for this key
-	my_replica = getReplicaType(imsg.key, memberNode->addr);
+	my_replica = lookup.myRole;
 	//if unknoown, send to correct replicas
 	if (my_replica == UNKNOWN){
-		cout << "RESENDING, STALE MEMBERSHIP LIST"<<endl;
-		emulNet->ENsend(&memberNode->addr, &replica_vect[0].nodeAddress,
-			imsg.toString());
+		if (ring->memberCount >= RF)
+			emulNet->ENsend(&memberNode->addr, &replica_vect[0].nodeAddress,
+				(char *)imsg.data, imsg.size);
 		return;
 	}
 
@@ -532,17 +586,15 @@ void MP2Node ::handle_delete( Message& imsg){
 	status = deletekey(imsg.key);
 	if (status){
 		log->logDeleteSuccess(&memberNode->addr, false,
-						imsg.transID, imsg.key);
+						imsg.transID, string(imsg.key));
 	}
 	else{
-		cout<<"delete failed"<<endl;
 		log->logDeleteFail(&memberNode->addr, false,
-						imsg.transID, imsg.key);
+						imsg.transID, string(imsg.key));
 	}
 	//send success message to coord
 	Message reply(imsg.transID, memberNode->addr, REPLY, status);
-	emulNet->ENsend(&memberNode->addr, &imsg.fromAddr,
-						reply.toString());
+	sendMessage(&imsg.fromAddr, reply);
 }
 
 
@@ -555,18 +607,20 @@ void MP2Node ::handle_delete( Message& imsg){
  *
  * Return Value : nothing
  *
- *Functionality : Updates the quorum count for a success reply message
+ *Functionality : Updates the quorum count for a success reply message,
+ *					or clears an acked BULK or UPDATE copy
  */
-void MP2Node ::handle_reply( Message& imsg){
+void MP2Node ::handle_reply( MessageView& imsg){
+	//ack of a copy: the replica holds its keys
+	if (bulk_frames.erase(imsg.transID))
+		return;
 	//If it was a success reply, update quorum count
 	if (imsg.success){
-		//update quorum cnt if already there
+		//update quorum cnt if already there, late replies are ignored
 		if (quorum_map.find(imsg.transID) != quorum_map.end()){
 			quorum_map[imsg.transID]++;
 			//cout << "TRANSACTION SUCCESS"<<endl;
 		}
-		else
-			cout << "ERROR : DELETED "<<endl;
 	}
 }
 
@@ -582,24 +636,50 @@ void MP2Node ::handle_reply( Message& imsg){
  *
  *Functionality : Stores the read reply locally if it is the most up to date
  */
-void MP2Node ::handle_readreply( Message& imsg){
+void MP2Node ::handle_readreply( MessageView& imsg){
+	map <int, int> :: iterator pending = quorum_map.find(imsg.transID);
+	//late reply: the read was already resolved or timed out
+	if (pending == quorum_map.end())
+		return;
+	Entry i_entry(imsg.value);
+	map <int, Entry> :: iterator cached = read_cache.find(imsg.transID);
 	//Add to the cache if not already there
-	if (read_cache.find(imsg.transID) ==read_cache.end() ){
-		//archive the value in the read cache
-		read_cache.emplace(make_pair(imsg.transID, imsg.value));
-
+	if (cached == read_cache.end()){
+		//archive the entry in the read cache
+		read_cache.emplace(imsg.transID, std::move(i_entry));
 	}
 	//Replace in cache only if it has a newer timestamp
-	else{
-		Entry i_entry(imsg.value);
-		Entry str_entry(read_cache[imsg.transID]);
-		if (i_entry.timestamp>str_entry.timestamp){
-			//replace with the input message
-			read_cache[imsg.transID] = imsg.value;
-		}
+	else if (i_entry.timestamp > cached->second.timestamp){
+		//replace with the input message
+		cached->second = std::move(i_entry);
 	}
 	//update quorum count for the original read message
-	quorum_map[imsg.transID]++;
+	pending->second++;
+}
+
+/**
+ * FUNCTION NAME: handle_bulk
+ *
+ * DESCRIPTION: Handles a bulk message
+ *
+ * Inputs : imsg - Message that came in
+ *
+ * Return Value : nothing
+ *
+ *Functionality : Stores every entry of the message in one pass,
+ *					unless a newer entry of the key is already here,
+ *					and acks the message to the sender
+ */
+void MP2Node ::handle_bulk( MessageView& imsg){
+	//local variables
+	string_view records = imsg.value;
+	string_view key, value;
+	int timestamp;
+
+	while (Entry::takeRecord(records, key, value, timestamp))
+		ht->merge(key, Entry(string(value), timestamp));
+	Message reply(imsg.transID, memberNode->addr, REPLY, true);
+	sendMessage(&imsg.fromAddr, reply);
 }
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -620,7 +700,7 @@ void MP2Node ::handle_readreply( Message& imsg){
  *
  *Functionality : Calls the function that handles the specific message
  */
-void MP2Node ::switchBoard(Message& imsg){
+void MP2Node ::switchBoard(MessageView& imsg){
 	//send to to message handler
 	switch (imsg.type){
 		case CREATE: return handle_create(imsg);
@@ -634,7 +714,63 @@ void MP2Node ::switchBoard(Message& imsg){
 		case REPLY: return handle_reply(imsg);
 
 		case READREPLY: return handle_readreply(imsg);
+
+		case BULK: return handle_bulk(imsg);
+	}
+}
+
+
+/**
+ * FUNCTION NAME: multicastMessage
+ *
+ * DESCRIPTION: Sends a message to a set of nodes, serializing it only once
+ *
+ * Inputs : r_nodes - nodes to send the message to
+ *			imsg - message to send
+ *
+ * Return Value : nothing
+ *
+ */
+void MP2Node ::multicastMessage(ReplicaSet& r_nodes, Message& imsg){
+	//local variables
+	vector <Address> r_addrs;
+	char* buff;
+	//the replicas are null nodes until the ring holds RF nodes
+	if (ring->memberCount < RF)
+		return;
+	for (auto& it : r_nodes)
+		r_addrs.push_back(it.nodeAddress);
+	if (par->WIRE_FORMAT == TEXT_WIRE){
+		emulNet->ENmulticast(&memberNode->addr, r_addrs, imsg.toString());
+		return;
+	}
+	//encode straight into the EmulNet buffer
+	buff = emulNet->ENalloc(imsg.encodedSize());
+	emulNet->ENmulticast(&memberNode->addr, r_addrs, buff, imsg.encode(buff));
+}
+
+
+/**
+ * FUNCTION NAME: sendMessage
+ *
+ * DESCRIPTION: Sends a message to one node in the configured wire format
+ *
+ * Inputs : to_addr - address to send the message to
+ *			imsg - message to send
+ *
+ * Return Value : nothing
+ *
+ */
+void MP2Node ::sendMessage(Address* to_addr, Message& imsg){
+	//local variables
+	char* buff;
+	if (par->WIRE_FORMAT == TEXT_WIRE){
+		emulNet->ENsend(&memberNode->addr, to_addr, imsg.toString());
+		return;
 	}
+	//encode straight into the EmulNet buffer
+	buff = emulNet->ENalloc(imsg.encodedSize());
+	emulNet->ENsendOwned(&memberNode->addr, to_addr, buff, imsg.encode(buff));
 }
 
 
@@ -680,16 +816,24 @@ void MP2Node ::sortArchives(){
 	map <int, int> :: iterator quorum_it = quorum_map.begin();
 
 	//for each message request waiting on replicas
-	for (; quorum_it != quorum_map.end(); quorum_it++){
-		Message target_msg = *message_cache[quorum_it->first];
+	//(the iterator is advanced in the body since entries may be erased)
+	while (quorum_it != quorum_map.end()){
+		map <int, Message*> :: iterator cached = message_cache.find(quorum_it->first);
+		//no request behind this count: drop it
+		if (cached == message_cache.end()){
+			request_time_map.erase(quorum_it->first);
+			read_cache.erase(quorum_it->first);
+			quorum_it = quorum_map.erase(quorum_it);
+			continue;
+		}
+		Message target_msg = *cached->second;
 		val = target_msg.value;
 		//If read msg, get the value
 		if (target_msg.type == READ){
 			//get reply value from the read cache
 			if (read_cache.find(quorum_it->first) != read_cache.end()){
 				//if it exists
-				Entry read_entry(read_cache[quorum_it->first]);
-				val = read_entry.value;
+				val = read_cache[quorum_it->first].value;
 			}
 		}
 		//check if quorum has been achieved & we've given enough time
@@ -707,7 +851,7 @@ void MP2Node ::sortArchives(){
 			delete message_cache[quorum_it->first];
 			message_cache.erase(quorum_it->first);
 			request_time_map.erase(quorum_it->first);
-			quorum_map.erase(quorum_it);
+			quorum_it = quorum_map.erase(quorum_it);
 		}
 		//if message has timed out
 		else if ( (cur_time -request_time_map[quorum_it->first] )>=TIMEOUT){
@@ -724,7 +868,10 @@ void MP2Node ::sortArchives(){
 			delete message_cache[quorum_it->first];
 			message_cache.erase(quorum_it->first);
 			request_time_map.erase(quorum_it->first);
-			quorum_map.erase(quorum_it);
+			quorum_it = quorum_map.erase(quorum_it);
+		}
+		else{
+			quorum_it++;
 		}
 	}
 }
@@ -808,23 +955,12 @@ void MP2Node ::logTrans(MessageType type, bool isCoordinator, int transID,
  * Return Value : nothing
  *
  */
-ReplicaType MP2Node ::getReplicaType (string ikey, Address addr){
-	//local variables
-	size_t i;
-	vector<Node> inodes;
-	//get all the nodes for this key
-	inodes = findNodes(ikey);
-	//Find out what replica addr is
-	for (i=0; i<inodes.size(); i++){
-		if (inodes[i].nodeAddress == addr){
-			switch (i){
-				case 0:	return PRIMARY;
-				case 1:	return SECONDARY;
-				case 2:	return TERTIARY;
-			}
-		}
-	}
-	return UNKNOWN;
+ReplicaType MP2Node ::getReplicaType (string_view ikey, Address addr){
+	const ReplicaLookup& lookup = lookupReplicas(hashFunction(ikey));
+	if (addr == memberNode->addr)
+		return lookup.myRole;
+	//the replica type is the position of addr among the nodes for this key
+	return replicaRole(lookup.nodes, addr);
 }
 
 
@@ -836,30 +972,40 @@ ReplicaType MP2Node ::getReplicaType (string ikey, Address addr){
  * DESCRIPTION: Find the replicas of the given keyfunction
  * 				This function is responsible for finding the replicas of a key
  */
-vector<Node> MP2Node::findNodes(string key) {
-	size_t pos = hashFunction(key);
-	vector<Node> addr_vec;
-	if (ring.size() >= 3) {
-		// if pos <= min || pos > max, the leader is the min
-		if (pos <= ring.at(0).getHashCode() || pos > ring.at(ring.size()-1).getHashCode()) {
-			addr_vec.emplace_back(ring.at(0));
-			addr_vec.emplace_back(ring.at(1));
-			addr_vec.emplace_back(ring.at(2));
-		}
-		else {
-			// go through the ring until pos <= node
-			for (int i=1; i<ring.size(); i++){
-				Node addr = ring.at(i);
-				if (pos <= addr.getHashCode()) {
-					addr_vec.emplace_back(addr);
-					addr_vec.emplace_back(ring.at((i+1)%ring.size()));
-					addr_vec.emplace_back(ring.at((i+2)%ring.size()));
-					break;
-				}
-			}
-		}
+ReplicaSet MP2Node::findNodes(string_view key) {
+	return findNodesAt(hashFunction(key));
+}
+
+/**
+ * FUNCTION NAME: findNodesAt
+ *
+ * DESCRIPTION: Find the replicas of the key at position pos on the ring
+ */
+ReplicaSet MP2Node::findNodesAt(uint64_t pos) {
+	return lookupReplicas(pos).nodes;
+}
+
+/**
+ * FUNCTION NAME: lookupReplicas
+ *
+ * DESCRIPTION: Replicas of ring position pos and the role of this node among them.
+ * 				Results are cached per ring slot until the ring changes.
+ */
+const ReplicaLookup& MP2Node::lookupReplicas(uint64_t pos) {
+	//at most one entry per node of the ring
+	size_t slot = ring->size() ? ring->successor(pos) : 0;
+	unordered_map<size_t, ReplicaLookup>::iterator it = replicaCache.find(slot);
+	if (it != replicaCache.end())
+		return it->second;
+
+	ReplicaLookup& lookup = replicaCache[slot];
+	// not enough nodes yet: every replica is left as a null node
+	if (ring->memberCount >= RF) {
+		// the primary is the first node at or after the key, wrapping around the ring
+		lookup.nodes = ring->replicasOf<RF>(pos);
 	}
-	return addr_vec;
+	lookup.myRole = replicaRole(lookup.nodes, memberNode->addr);
+	return lookup;
 }
 
 /**
@@ -896,112 +1042,254 @@ int MP2Node::enqueueWrapper(void *env, char *buff, int size) {
  *				1) Ensures that there are three "CORRECT" replicas of all the keys in spite of failures and joins
  *				Note:- "CORRECT" replicas implies that every key is replicated in its two neighboring nodes in the ring
  */
-void MP2Node::stabilizationProtocol() {
+void MP2Node::stabilizationProtocol(const Ring& old_ring) {
 	/*
-	 * IMPLELENTED
+	 * Implement this
 	 */
 	 //local variables
-	 vector <Node> replica_vect;
-	 ReplicaType new_type;
-	 string my_key;
-	 bool flag;
-	 map<string, string> :: iterator hash_it = ht->hashTable.begin();
-
-	 //for each entry in my hash table: check if node was alwas primary
-	 for (; hash_it!=ht->hashTable.end(); hash_it++){
-		 my_key = hash_it->first;
-		 //Get the previous replica type of this node for this key
-		 Entry my_entry(hash_it->second);
-		 replica_vect = findNodes(my_key);
-		 new_type = getReplicaType(my_key, memberNode->addr);
-
-		//if node was always primary, and is still primary
-		 if ((my_entry.replica == PRIMARY) && (new_type==PRIMARY)){
-			 //If any replicas have failed or joined
-			if (!animateReplicas(hasMyReplicas, replica_vect)){
-				//for each node, copy over, and send an update message
-				for (auto& vect_it : replica_vect){
-					new_type = getReplicaType(my_key, vect_it.nodeAddress);
-					//Don't send message to node-self
-					if (new_type != PRIMARY){
-						//copy over to the right vector if not already there
-						flag = false;
-						for (auto& it : haveReplicasOf){
-							//flag if you find it
-							if (vect_it.nodeAddress == it.nodeAddress)
-								flag = true;
-						}
-						if (!flag)
-							hasMyReplicas.push_back(vect_it.nodeAddress);
-						//send the message
-						Message up_msg(g_transID++, memberNode->addr, UPDATE,
-							 my_key, my_entry.value, new_type );
-						emulNet->ENsend (&memberNode->addr, &vect_it.nodeAddress,
-							 up_msg.toString() );
-					}
-				}
-			}
+	 ReplicaSet old_vect;
+	 size_t k, p, first, last;
+	 vector <pair<uint64_t, uint64_t>> arcs;
+	 vector <bool> affected(HT_PARTITIONS, false);
+	 vector <string_view> keys;
+	 vector <uint64_t> positions;
+
+	 //keys have no replicas until the ring has enough members
+	 if (ring->memberCount < RF)
+		 return;
+
+	 //ring ranges whose replicas may have changed, and the partitions they cover
+	 old_ring.changedArcs<RF>(*ring, arcs);
+	 for (auto& arc : arcs){
+		 //arc is (start, end], start == end is the whole ring
+		 first = HashTable::partitionOf(arc.first + 1);
+		 last = HashTable::partitionOf(arc.second);
+		 if (arc.first < arc.second){
+			 for (p = first; p <= last; p++)
+				 affected[p] = true;
 		 }
 		 else{
-			 new_type = getReplicaType(my_key, memberNode->addr);
-			 //If node is a new primary, populae right vector & send updates
-			 if (new_type == PRIMARY){
-				 hasMyReplicas.clear();
-				 //Send message to all other replicas
-				 for (auto& vect_it : replica_vect){
- 					//send update message to new replica
- 					new_type = getReplicaType(my_key, vect_it.nodeAddress);
-					if (new_type != PRIMARY){
-						//copy over to the relevant vector
-	 					hasMyReplicas.push_back(vect_it.nodeAddress);
-						Message up_msg(g_transID++, memberNode->addr, UPDATE,
-	 						 my_key, my_entry.value, new_type );
-	 					emulNet->ENsend (&memberNode->addr, &vect_it.nodeAddress,
-	 						 up_msg.toString() );
-					}
- 				}
-				//update type to primary
-				updateKeyValue(my_key, my_entry.value, PRIMARY);
+			 for (p = first; p < HT_PARTITIONS; p++)
+				 affected[p] = true;
+			 for (p = 0; p <= last; p++)
+				 affected[p] = true;
+		 }
+	 }
+
+	 for (p = 0; p < HT_PARTITIONS; p++){
+		 //keys of untouched ranges are never visited
+		 HashTable::Store& store = ht->partition(p);
+		 if (!affected[p] || store.empty())
+			 continue;
+
+		 //place the keys of the partition on the ring in one batch
+		 keys.clear();
+		 for (auto& kv : store)
+			 keys.push_back(kv.first);
+		 positions.resize(keys.size());
+		 hash64Batch(keys.data(), keys.size(), positions.data());
+
+		 //for each entry: compare its replicas before and after the change
+		 HashTable :: iterator hash_it = store.begin();
+		 for (k = 0; hash_it!=store.end(); hash_it++, k++){
+			 const ReplicaLookup& lookup = lookupReplicas(positions[k]);
+			 ReplicaSet new_vect = lookup.nodes;
+			 old_vect = old_ring.replicasOf<RF>(positions[k]);
+
+			 //keys that kept their replicas cost nothing
+			 if (!replicasChanged(old_vect, new_vect))
+				 continue;
+			 //nodes see the ring change in different steps, so every holder
+			 //sends the key to every other replica and the replicas merge copies
+			 for (auto& vect_it : new_vect){
+				 if (vect_it.nodeAddress == memberNode->addr)
+					 continue;
+				 //BULK messages only exist in the binary wire format
+				 if (par->WIRE_FORMAT == TEXT_WIRE){
+					 Message up_msg(g_transID++, memberNode->addr, UPDATE,
+						 hash_it->first, hash_it->second.value,
+						 replicaRole(new_vect, vect_it.nodeAddress));
+					 sendMessage(&vect_it.nodeAddress, up_msg);
+				 }
+				 else
+					 queueTransfer(vect_it.nodeAddress, hash_it->first);
 			 }
 		 }
 	 }
+	 flushTransfers();
+}
+
+
+/**
+ * FUNCTION NAME: queueTransfer
+ *
+ * DESCRIPTION: Adds a key to the bulk transfer to a replica
+ *
+ * Inputs : to - the replica
+ *			key - the key to copy
+ *
+ * Return Value : nothing
+ *
+ */
+void MP2Node ::queueTransfer(Address& to, string_view key){
+	BulkTransfer& transfer = transfers[*(int *)(to.addr)];
+	//start a new transfer
+	if (transfer.keys.empty()){
+		transfer.to = to;
+		transfer.next = 0;
+	}
+	transfer.keys.emplace_back(key);
+}
+
+
+/**
+ * FUNCTION NAME: flushTransfers
+ *
+ * DESCRIPTION: Sends the next BULK messages of every bulk transfer
+ *
+ * Return Value : nothing
+ *
+ *Functionality : Queues again the keys of copies not acked within TIMEOUT,
+ *					if the target still replicates them. Then packs the current
+ *					entries of the next keys of each transfer in messages of at most
+ *					MAX_MSG_SIZE, up to BULK_FRAMES per transfer, and keeps their keys
+ *					until the ack. Entries too big for a BULK message go alone in an
+ *					UPDATE. A transfer resumes from its cursor on the next call
+ *					and is dropped once all its keys are sent.
+ */
+void MP2Node ::flushTransfers(){
+	//local variables
+	string records;
+	vector<string> keys;
+	int frames, transID;
+	size_t end;
+	long cur_time = par->getcurrtime();
+	//room for records in a message EmulNet accepts
+	size_t budget = par->MAX_MSG_SIZE - WIRE_HEADER_SIZE - 2 * sizeof(int) - 1;
+	map <int, BulkFrame> :: iterator frame_it = bulk_frames.begin();
+	map <int, BulkTransfer> :: iterator it;
+
+	//lost messages or acks: copy the keys again
+	while (frame_it != bulk_frames.end()){
+		BulkFrame& frame = frame_it->second;
+		if (cur_time - frame.sent < TIMEOUT){
+			frame_it++;
+			continue;
+		}
+		for (auto& key : frame.keys){
+			if (ht->find(key) != NULL && replicaRole(findNodes(key), frame.to) != UNKNOWN)
+				queueTransfer(frame.to, key);
+		}
+		frame_it = bulk_frames.erase(frame_it);
+	}
+
+	it = transfers.begin();
+	while (it != transfers.end()){
+		BulkTransfer& transfer = it->second;
+		for (frames = 0; frames < BULK_FRAMES && transfer.next < transfer.keys.size(); frames++){
+			records.clear();
+			keys.clear();
+			//fill the message with as many records as fit
+			for (end = transfer.next; end < transfer.keys.size(); end++){
+				string_view key = transfer.keys[end];
+				const Entry* entry = ht->find(key);
+				//deleted meanwhile: nothing to copy
+				if (entry == NULL)
+					continue;
+				//too big for a BULK message: copy it alone in an UPDATE, which is no
+				//bigger than the request that stored it, and keep it until the ack
+				if (entry->recordSize(key) > budget){
+					transID = g_transID++;
+					Message up_msg(transID, memberNode->addr, UPDATE, string(key),
+						entry->value, replicaRole(findNodes(key), transfer.to));
+					bulk_frames[transID] = BulkFrame{transfer.to, {string(key)}, cur_time};
+					sendMessage(&transfer.to, up_msg);
+					continue;
+				}
+				if (records.size() + entry->recordSize(key) > budget)
+					break;
+				entry->appendRecord(records, key);
+				keys.emplace_back(key);
+			}
+			if (!records.empty()){
+				transID = g_transID++;
+				Message bulk_msg(transID, memberNode->addr, BULK, string(), records);
+				bulk_frames[transID] = BulkFrame{transfer.to, std::move(keys), cur_time};
+				sendMessage(&transfer.to, bulk_msg);
+			}
+			transfer.next = end;
+		}
+		//drop finished transfers
+		if (transfer.next == transfer.keys.size())
+			it = transfers.erase(it);
+		else
+			it++;
+	}
 }
 
 
 /**
- * FUNCTION NAME: animateReplicas
+ * FUNCTION NAME: retargetTransfers
  *
- * DESCRIPTION: Checks if all the replicas in the old vector
- *					are in the new one.
- *					Clears the old vector if they differ
+ * DESCRIPTION: Re-checks the bulk transfers after a ring change
  *
- * Inputs : old_vect
- *			new_vect
+ * Inputs : old_ring - the ring before the change
  *
- * Return Value : same - boolean on if the vectors are the same
+ * Return Value : nothing
  *
+ *Functionality : Keeps the unsent keys whose replicas are the same on the old
+ *					and the current ring, so the target still replicates them.
+ *					The stabilization pass that follows sends the keys whose
+ *					replicas changed to all of their replicas, so those are
+ *					dropped, as are all keys for a target that left the ring.
  */
-bool MP2Node ::animateReplicas(vector<Node>old_vect, vector<Node>new_vect){
+void MP2Node ::retargetTransfers(const Ring& old_ring){
 	//local variables
-	bool same = true;
-	int same_cnt =0;
-	vector <Node> :: iterator old_it = old_vect.begin();
-	vector <Node> :: iterator new_it = new_vect.begin();
-
-
-	//iterat over both vectors and make sure they are the same
-	for (; old_it!=old_vect.end(); old_it++){
-		//check if it is in the new oone
-		for (new_it= new_vect.begin(); new_it!=new_vect.end(); new_it++){
-			if (new_it->nodeAddress == old_it->nodeAddress)
-				same_cnt++;
+	vector<string> kept;
+	uint64_t pos;
+	size_t i;
+	map <int, BulkTransfer> :: iterator it = transfers.begin();
+
+	while (it != transfers.end()){
+		BulkTransfer& transfer = it->second;
+		kept.clear();
+		if (ring->hasMember(transfer.to)){
+			for (i = transfer.next; i < transfer.keys.size(); i++){
+				pos = hashFunction(transfer.keys[i]);
+				if (!replicasChanged(old_ring.replicasOf<RF>(pos), lookupReplicas(pos).nodes))
+					kept.push_back(std::move(transfer.keys[i]));
+			}
+		}
+		if (kept.empty()){
+			it = transfers.erase(it);
+			continue;
 		}
+		transfer.keys.swap(kept);
+		transfer.next = 0;
+		it++;
 	}
-	//The old vector is cleared if they don't match exactly
-	if (same_cnt !=2){
-		cout<<"new set of neighbors"<<endl;
-		old_vect.clear();
-		same = false;
+}
+
+
+/**
+ * FUNCTION NAME: replicasChanged
+ *
+ * DESCRIPTION: Compares the replicas of a key before and after a ring change
+ *
+ * Inputs : old_vect - replicas of the key on the old ring
+ *			new_vect - replicas of the key on the current ring
+ *
+ * Return Value : true if any replica of the key changed
+ *
+ */
+bool MP2Node ::replicasChanged(const ReplicaSet& old_vect, const ReplicaSet& new_vect){
+	//local variables
+	size_t i;
+
+	for (i = 0; i < RF; i++){
+		if (memcmp(old_vect[i].nodeAddress.addr, new_vect[i].nodeAddress.addr,
+				sizeof(old_vect[i].nodeAddress.addr)) != 0)
+			return true;
 	}
-	return same;
+	return false;
 }
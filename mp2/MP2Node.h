@@ -13,6 +13,8 @@
 #include "stdincludes.h"
 #include "EmulNet.h"
 #include "Node.h"
+#include "Ring.h"
+#include "Hash.h"
 #include "HashTable.h"
 #include "Log.h"
 #include "Params.h"
@@ -20,9 +22,31 @@
 #include "Queue.h"
 
 // Macros
-#define QUORUM_CNT 2
+#define QUORUM_CNT (RF/2 + 1)
 #define TIMEOUT 20
 #define WAITING 5
+// BULK messages sent to each target per round, the rest of a transfer waits
+#define BULK_FRAMES 4
+
+// Replicas of a ring position and the role of this node among them
+struct ReplicaLookup {
+	ReplicaSet nodes;
+	ReplicaType myRole;
+};
+
+// Keys to copy to one replica, the ones before next were already sent
+struct BulkTransfer {
+	Address to;
+	vector<string> keys;
+	size_t next;
+};
+
+// Keys of a BULK or UPDATE copy sent to a replica and not acked yet
+struct BulkFrame {
+	Address to;
+	vector<string> keys;
+	long sent;
+};
 
 /**
  * CLASS NAME: MP2Node
@@ -36,12 +60,13 @@
  */
 class MP2Node {
 private:
-	// Vector holding the next two neighbors in the ring who have my replicas
-	vector<Node> hasMyReplicas;
-	// Vector holding the previous two neighbors in the ring whose replicas I have
-	vector<Node> haveReplicasOf;
-	// Ring
-	vector<Node> ring;
+	// Ring, a snapshot shared with every node that has the same view
+	shared_ptr<const Ring> ring;
+	// Membership epoch the ring was built from (-1 before the first build)
+	long ringEpoch;
+	// Replicas already looked up on the current ring, by index of the key's successor
+	// node: every position between two nodes has the same replicas
+	unordered_map<size_t, ReplicaLookup> replicaCache;
 	// Hash Table
 	HashTable * ht;
 	// Member representing this member
@@ -58,7 +83,9 @@ private:
 	map <int, int> quorum_map;			//id : quorum cnt
 	map <int, long> request_time_map;	//id vs time
 	map <int, Message*> message_cache;	//id : msg ptr
-	map <int, string> read_cache;
+	map <int, Entry> read_cache;
+	map <int, BulkTransfer> transfers;	//node id : keys being copied to it
+	map <int, BulkFrame> bulk_frames;	//id : keys waiting for an ack
 	//vector <Message> message_cache;
 
 public:
@@ -66,11 +93,15 @@ public:
 	Member * getMemberNode() {
 		return this->memberNode;
 	}
+	size_t ringSize() {
+		return ring->memberCount;
+	}
 
 	// ring functionalities
 	void updateRing();
 	vector<Node> getMembershipList();
-	size_t hashFunction(string key);
+	bool applyMemberEvents(vector<Node>& nodes, vector<MemberEvent>& changes);
+	uint64_t hashFunction(string_view key);
 	void findNeighbors();
 
 	// client side CRUD APIs
@@ -90,36 +121,44 @@ public:
 	void dispatchMessages(Message message);
 
 	// find the addresses of nodes that are responsible for a key
-	vector<Node> findNodes(string key);
+	ReplicaSet findNodes(string_view key);
+	ReplicaSet findNodesAt(uint64_t pos);
+	const ReplicaLookup& lookupReplicas(uint64_t pos);
 
 	// server
-	bool createKeyValue(string key, string value, ReplicaType replica);
-	string readKey(string key);
-	bool updateKeyValue(string key, string value, ReplicaType replica);
-	bool deletekey(string key);
+	bool createKeyValue(string_view key, string_view value);
+	const Entry* readKey(string_view key);
+	bool updateKeyValue(string_view key, string_view value);
+	bool deletekey(string_view key);
 
 	// stabilization protocol - handle multiple failures
-	void stabilizationProtocol();
+	void stabilizationProtocol(const Ring& old_ring);
+	void queueTransfer(Address& to, string_view key);
+	void flushTransfers();
+	void retargetTransfers(const Ring& old_ring);
 
 
 	//Helper Functions
 	void dissectMsg( char* data,  int& inID, Address& inAddr, MessageType& type,
 					string& iKey, string& iValue, ReplicaType replica, int size);
-	ReplicaType getReplicaType (string ikey, Address addr);
+	ReplicaType getReplicaType (string_view ikey, Address addr);
 	void sortArchives();
-	bool animateReplicas(vector<Node>old_vect, vector<Node>new_vect);
+	bool replicasChanged(const ReplicaSet& old_vect, const ReplicaSet& new_vect);
 	void archiveAdd(Message& imsg);
+	void multicastMessage(ReplicaSet& r_nodes, Message& imsg);
+	void sendMessage(Address* to_addr, Message& imsg);
 	void logTrans(MessageType type, bool isCoordinator, int transID,
 		string key, string value, bool success);
 
 	//message handlers
-	void switchBoard(Message& imsg);
-	void handle_create( Message& imsg);
-	void handle_read( Message& imsg);
-	void handle_update( Message& imsg);
-	void handle_delete( Message& imsg);
-	void handle_reply( Message& imsg);
-	void handle_readreply( Message& imsg);
+	void switchBoard(MessageView& imsg);
+	void handle_create( MessageView& imsg);
+	void handle_read( MessageView& imsg);
+	void handle_update( MessageView& imsg);
+	void handle_delete( MessageView& imsg);
+	void handle_reply( MessageView& imsg);
+	void handle_readreply( MessageView& imsg);
+	void handle_bulk( MessageView& imsg);
 
 	~MP2Node();
 };
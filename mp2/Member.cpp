@@ -38,12 +38,12 @@ bool Address::operator ==(const Address& anotherAddress) {
 /**
  * Constructor
  */
-MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp) {}
+MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp), lastChanged(timestamp) {}
 
 /**
  * Constuctor
  */
-MemberListEntry::MemberListEntry(int id, short port): id(id), port(port) {}
+MemberListEntry::MemberListEntry(int id, short port): id(id), port(port), lastChanged(0) {}
 
 /**
  * Copy constructor
@@ -53,6 +53,7 @@ MemberListEntry::MemberListEntry(const MemberListEntry &anotherMLE) {
 	this->id = anotherMLE.id;
 	this->port = anotherMLE.port;
 	this->timestamp = anotherMLE.timestamp;
+	this->lastChanged = anotherMLE.lastChanged;
 }
 
 /**
@@ -64,6 +65,7 @@ MemberListEntry& MemberListEntry::operator =(const MemberListEntry &anotherMLE)
 	swap(id, temp.id);
 	swap(port, temp.port);
 	swap(timestamp, temp.timestamp);
+	swap(lastChanged, temp.lastChanged);
 	return *this;
 }
 
@@ -153,6 +155,9 @@ Member::Member(const Member &anotherMember) {
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
 	this->myPos = anotherMember.myPos;
+	this->memberIndex = anotherMember.memberIndex;
+	this->epoch = anotherMember.epoch;
+	this->events = anotherMember.events;
 	this->mp1q = anotherMember.mp1q;
 	this->mp2q = anotherMember.mp2q;
 }
@@ -171,7 +176,46 @@ Member& Member::operator =(const Member& anotherMember) {
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
 	this->myPos = anotherMember.myPos;
+	this->memberIndex = anotherMember.memberIndex;
+	this->epoch = anotherMember.epoch;
+	this->events = anotherMember.events;
 	this->mp1q = anotherMember.mp1q;
 	this->mp2q = anotherMember.mp2q;
 	return *this;
 }
+
+/**
+ * FUNCTION NAME: logEvent
+ *
+ * DESCRIPTION: Advances the membership epoch and remembers the change,
+ * 				forgetting the oldest one beyond MAX_MEMBER_EVENTS
+ */
+void Member::logEvent(MemberEventType type, MemberListEntry &entry) {
+	epoch++;
+	events.push_back(MemberEvent(epoch, type, entry.id, entry.port));
+	if ( events.size() > MAX_MEMBER_EVENTS ) {
+		events.pop_front();
+	}
+}
+
+/**
+ * FUNCTION NAME: eventsSince
+ *
+ * DESCRIPTION: Appends the changes made after epoch since to changes, oldest first.
+ * 				Returns false if some of them were already forgotten, in which case
+ * 				the caller has to rebuild its view from the membership list.
+ */
+bool Member::eventsSince(long since, vector<MemberEvent> &changes) {
+	if ( since == epoch ) {
+		return true;
+	}
+	if ( since > epoch || events.empty() || events.front().epoch > since + 1 ) {
+		return false;
+	}
+	for ( deque<MemberEvent>::iterator it = events.begin(); it != events.end(); it++ ) {
+		if ( it->epoch > since ) {
+			changes.push_back(*it);
+		}
+	}
+	return true;
+}
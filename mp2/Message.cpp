@@ -5,62 +5,14 @@
  **********************************/
 #include "Message.h"
 
-/**
- * Constructor
- */
-// transID::fromAddr::CREATE::key::value::ReplicaType
-// transID::fromAddr::READ::key
-// transID::fromAddr::UPDATE::key::value::ReplicaType
-// transID::fromAddr::DELETE::key
-// transID::fromAddr::REPLY::sucess
-// transID::fromAddr::READREPLY::value
-Message::Message(string message){
-	this->delimiter = "::";
-	vector<string> tuple;
-	size_t pos = message.find(delimiter);
-	size_t start = 0;
-	while (pos != string::npos) {
-		string field = message.substr(start, pos-start);
-		tuple.push_back(field);
-		start = pos + 2;
-		pos = message.find(delimiter, start);
-	}
-	tuple.push_back(message.substr(start));
-
-	transID = stoi(tuple.at(0));
-	Address addr(tuple.at(1));
-	fromAddr = addr;
-	type = static_cast<MessageType>(stoi(tuple.at(2)));
-	switch(type){
-		case CREATE:
-		case UPDATE:
-			key = tuple.at(3);
-			value = tuple.at(4);
-			if (tuple.size() > 5)
-				replica = static_cast<ReplicaType>(stoi(tuple.at(5)));
-			break;
-		case READ:
-		case DELETE:
-			key = tuple.at(3);
-			break;
-		case REPLY:
-			if (tuple.at(3) == "1")
-				success = true;
-			else
-				success = false;
-			break;
-		case READREPLY:
-			value = tuple.at(3);
-			break;
-	}
-}
-
 /**
  * Constructor
  */
 // construct a create or update message
 Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value, ReplicaType _replica){
 	this->delimiter = "::";
+	replica = UNKNOWN;
+	success = false;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -88,6 +40,8 @@ Message::Message(const Message& anotherMessage) {
  */
 Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value){
 	this->delimiter = "::";
+	replica = UNKNOWN;
+	success = false;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -101,6 +55,8 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key
 // construct a read or delete message
 Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key){
 	this->delimiter = "::";
+	replica = UNKNOWN;
+	success = false;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -113,6 +69,8 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key
 // construct reply message
 Message::Message(int _transID, Address _fromAddr, MessageType _type, bool _success){
 	this->delimiter = "::";
+	replica = UNKNOWN;
+	success = false;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -125,6 +83,8 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, bool _succe
 // construct read reply message
 Message::Message(int _transID, Address _fromAddr, string _value){
 	this->delimiter = "::";
+	replica = UNKNOWN;
+	success = false;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = READREPLY;
@@ -156,10 +116,56 @@ string Message::toString(){
 		case READREPLY:
 			message += value;
 			break;
+		case BULK:
+			// never sent in the text wire format
+			break;
 	}
 	return message;
 }
 
+/**
+ * FUNCTION NAME: encodedSize
+ *
+ * DESCRIPTION: Size of the message in the binary wire format
+ */
+int Message::encodedSize(){
+	return WIRE_HEADER_SIZE + 2 * sizeof(int) + key.size() + value.size();
+}
+
+/**
+ * FUNCTION NAME: encode
+ *
+ * DESCRIPTION: Writes the message in the binary wire format into buff,
+ * 				which must hold at least encodedSize() bytes
+ *
+ * RETURNS:
+ * number of bytes written
+ */
+int Message::encode(char *buff){
+	int len;
+	char *ptr = buff + WIRE_HEADER_SIZE;
+
+	buff[0] = WIRE_MAGIC;
+	buff[1] = (char)type;
+	buff[2] = (char)((type == CREATE || type == UPDATE) ? replica : UNKNOWN);
+	buff[3] = (char)(type == REPLY && success);
+	memcpy(buff + 4, &transID, sizeof(int));
+	memcpy(buff + 8, &fromAddr.addr, sizeof(fromAddr.addr));
+
+	len = key.size();
+	memcpy(ptr, &len, sizeof(int));
+	ptr += sizeof(int);
+	memcpy(ptr, key.data(), len);
+	ptr += len;
+	len = value.size();
+	memcpy(ptr, &len, sizeof(int));
+	ptr += sizeof(int);
+	memcpy(ptr, value.data(), len);
+	ptr += len;
+
+	return ptr - buff;
+}
+
 /**
  * Assignment operator overloading
  */
@@ -174,3 +180,137 @@ Message& Message::operator =(const Message& anotherMessage) {
 	this->value = anotherMessage.value;
 	return *this;
 }
+
+/**
+ * Constructor
+ *
+ * DESCRIPTION: Parses a received buffer in either wire format without copying it
+ */
+MessageView::MessageView(const char *data, int size): data(data), size(size){
+	replica = UNKNOWN;
+	success = false;
+	valid = false;
+	if (size > 0 && data[0] == WIRE_MAGIC)
+		parseBinary();
+	else
+		parseText();
+}
+
+/**
+ * FUNCTION NAME: parseBinary
+ *
+ * DESCRIPTION: Parses the binary wire form
+ */
+void MessageView::parseBinary(){
+	int klen, vlen;
+	const char *ptr = data + WIRE_HEADER_SIZE;
+	const char *end = data + size;
+
+	// both length fields must be there before they can be read
+	if (size < WIRE_HEADER_SIZE + (int)(2 * sizeof(int)) || (unsigned char)data[1] > BULK)
+		return;
+	type = static_cast<MessageType>((unsigned char)data[1]);
+	replica = static_cast<ReplicaType>((unsigned char)data[2]);
+	success = data[3] != 0;
+	memcpy(&transID, data + 4, sizeof(int));
+	memcpy(&fromAddr.addr, data + 8, sizeof(fromAddr.addr));
+
+	memcpy(&klen, ptr, sizeof(int));
+	ptr += sizeof(int);
+	if (klen < 0 || klen > end - ptr - (int)sizeof(int))
+		return;
+	key = string_view(ptr, klen);
+	ptr += klen;
+	memcpy(&vlen, ptr, sizeof(int));
+	ptr += sizeof(int);
+	if (vlen < 0 || vlen > end - ptr)
+		return;
+	value = string_view(ptr, vlen);
+	valid = true;
+}
+
+/**
+ * FUNCTION NAME: parseNumber
+ *
+ * DESCRIPTION: Parses the whole of field as a decimal number into out
+ *
+ * RETURNS:
+ * false if the field is empty, not a number, out of range or followed by anything else
+ */
+template <class T>
+static bool parseNumber(string_view field, T& out){
+	from_chars_result res = from_chars(field.data(), field.data() + field.size(), out);
+	return res.ec == errc() && res.ptr == field.data() + field.size();
+}
+
+/**
+ * FUNCTION NAME: parseText
+ *
+ * DESCRIPTION: Parses the "::" delimited text form written by Message::toString.
+ * 				The view stays invalid unless every field the type needs is there and
+ * 				every number parses.
+ */
+// transID::fromAddr::CREATE::key::value::ReplicaType
+// transID::fromAddr::READ::key
+// transID::fromAddr::UPDATE::key::value::ReplicaType
+// transID::fromAddr::DELETE::key
+// transID::fromAddr::REPLY::sucess
+// transID::fromAddr::READREPLY::value
+void MessageView::parseText(){
+	string_view message(data, size);
+	string_view tuple[6];
+	size_t fields = 0, start = 0, pos;
+	int id = 0, itype = 0, ireplica = 0;
+	short port = 0;
+
+	pos = message.find("::");
+	while (pos != string_view::npos && fields < 5) {
+		tuple[fields++] = message.substr(start, pos - start);
+		start = pos + 2;
+		pos = message.find("::", start);
+	}
+	tuple[fields++] = message.substr(start);
+
+	// transID, address and type, then at least one field of the body
+	if (fields < 4 || !parseNumber(tuple[0], transID))
+		return;
+	pos = tuple[1].find(":");
+	if (pos == string_view::npos || !parseNumber(tuple[1].substr(0, pos), id)
+		|| !parseNumber(tuple[1].substr(pos + 1), port))
+		return;
+	memcpy(&fromAddr.addr[0], &id, sizeof(int));
+	memcpy(&fromAddr.addr[4], &port, sizeof(short));
+	if (!parseNumber(tuple[2], itype) || itype < CREATE || itype > READREPLY)
+		return;
+	type = static_cast<MessageType>(itype);
+	switch(type){
+		case CREATE:
+		case UPDATE:
+			if (fields < 5)
+				return;
+			key = tuple[3];
+			value = tuple[4];
+			if (fields > 5) {
+				if (!parseNumber(tuple[5], ireplica) || ireplica < 0 || ireplica > UNKNOWN)
+					return;
+				replica = static_cast<ReplicaType>(ireplica);
+			}
+			break;
+		case READ:
+		case DELETE:
+			key = tuple[3];
+			break;
+		case REPLY:
+			if (tuple[3] != "1" && tuple[3] != "0")
+				return;
+			success = (tuple[3] == "1");
+			break;
+		case READREPLY:
+			value = tuple[3];
+			break;
+		case BULK:
+			// never sent in the text wire format
+			return;
+	}
+	valid = true;
+}
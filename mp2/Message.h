@@ -10,6 +10,15 @@
 #include "Member.h"
 #include "common.h"
 
+/**
+ * Binary wire format:
+ * |magic|type|replica|success|transID (4)|fromAddr (6)|key length (4)|key|value length (4)|value|
+ * A BULK message has no key, its value is a sequence of entry records (see Entry)
+ * The magic byte can never start a text message, whose first field is a transID
+ */
+#define WIRE_MAGIC ((char)0xB1)
+#define WIRE_HEADER_SIZE 14
+
 /**
  * CLASS NAME: Message
  *
@@ -26,8 +35,6 @@ public:
 	bool success; // success or not
 	// delimiter
 	string delimiter;
-	// construct a message from a string
-	Message(string message);
 	Message(const Message& anotherMessage);
 	// construct a create or update message
 	Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value);
@@ -41,6 +48,35 @@ public:
 	Message& operator = (const Message& anotherMessage);
 	// serialize to a string
 	string toString();
+	// serialize to the binary wire format
+	int encodedSize();
+	int encode(char *buff);
+};
+
+/**
+ * CLASS NAME: MessageView
+ *
+ * DESCRIPTION: Read only view of a received message, parsed in place.
+ * 				key and value point into the receive buffer, which must outlive the view.
+ */
+class MessageView{
+public:
+	MessageType type;
+	ReplicaType replica;
+	string_view key;
+	string_view value;
+	Address fromAddr;
+	int transID;
+	bool success;
+	// false when the frame is truncated or its lengths overrun it
+	bool valid;
+	// the whole received frame, e.g. to forward it unchanged
+	const char *data;
+	int size;
+	MessageView(const char *data, int size);
+private:
+	void parseText();
+	void parseBinary();
 };
 
 #endif
@@ -9,7 +9,10 @@
 /**
  * constructor
  */
-Node::Node() {}
+Node::Node() {
+	this->nodeAddress.init();
+	this->nodeHashCode = 0;
+}
 
 /**
  * constructor
@@ -19,6 +22,14 @@ Node::Node(Address address) {
 	computeHashCode();
 }
 
+/**
+ * constructor of the vnode-th virtual node of a member
+ */
+Node::Node(Address address, int vnode) {
+	this->nodeAddress = address;
+	computeHashCode(vnode);
+}
+
 /**
  * Destructor
  */
@@ -27,10 +38,14 @@ Node::~Node() {}
 /**
  * FUNCTION NAME: computeHashCode
  *
- * DESCRIPTION: This function computes the hash code of the node address
+ * DESCRIPTION: This function computes the position of a virtual node on the 64-bit ring
+ * 				from the node address and the virtual node number
  */
-void Node::computeHashCode() {
-	nodeHashCode = hashFunc(nodeAddress.addr)%RING_SIZE;
+void Node::computeHashCode(int vnode) {
+	char point[sizeof(nodeAddress.addr) + sizeof(int)];
+	memcpy(point, nodeAddress.addr, sizeof(nodeAddress.addr));
+	memcpy(point + sizeof(nodeAddress.addr), &vnode, sizeof(int));
+	nodeHashCode = hash64(point, sizeof(point));
 }
 
 /**
@@ -62,7 +77,7 @@ bool Node::operator < (const Node& another) const {
  *
  * DESCRIPTION: return hash code of the node
  */
-size_t Node::getHashCode() {
+uint64_t Node::getHashCode() const {
 	return nodeHashCode;
 }
 
@@ -80,7 +95,7 @@ Address * Node::getAddress() {
  *
  * DESCRIPTION: set the hash code of the node
  */
-void Node::setHashCode(size_t hashCode) {
+void Node::setHashCode(uint64_t hashCode) {
 	this->nodeHashCode = hashCode;
 }
 
@@ -9,21 +9,22 @@
 
 #include "stdincludes.h"
 #include "Member.h"
+#include "Hash.h"
 
 class Node {
 public:
 	Address nodeAddress;
-	size_t nodeHashCode;
-	std::hash<string> hashFunc;
+	uint64_t nodeHashCode;
 	Node();
 	Node(Address address);
+	Node(Address address, int vnode);
 	Node(const Node& another);
 	Node& operator=(const Node& another);
 	bool operator < (const Node& another) const;
-	void computeHashCode();
-	size_t getHashCode();
+	void computeHashCode(int vnode = 0);
+	uint64_t getHashCode() const;
 	Address * getAddress();
-	void setHashCode(size_t hashCode);
+	void setHashCode(uint64_t hashCode);
 	void setAddress(Address address);
 	virtual ~Node();
 };
@@ -19,6 +19,8 @@ Params::Params(): PORTNUM(8001) {}
 void Params::setparams(char *config_file) {
 	//trace.funcEntry("Params::setparams");
 	char CRUD[10];
+	char key[64];
+	char value[64];
 	FILE *fp = fopen(config_file,"r");
 
 	fscanf(fp,"MAX_NNB: %d", &MAX_NNB);
@@ -40,6 +42,19 @@ void Params::setparams(char *config_file) {
 		this->CRUDTEST = DELETE_TEST;
 	}
 
+	// Optional settings follow as "KEY: value" lines in any order
+	EN_BUFFSIZE = 0;
+	DELAY_MODEL = NO_DELAY;
+	DELAY_MIN = 0;
+	DELAY_MAX = 0;
+	DELAY_ALPHA = 1.5;
+	MP1_PROTOCOL = GOSSIP_PROTOCOL;
+	WIRE_FORMAT = TEXT_WIRE;
+	VNODES = 1;
+	while ( fscanf(fp, " %63[^:]: %63s", key, value) == 2 ) {
+		setoption(key, value);
+	}
+
 	//printf("Parameters of the test case: %d %d %d %lf\n", MAX_NNB, SINGLE_FAILURE, DROP_MSG, MSG_DROP_PROB);
 
 	EN_GPSZ = MAX_NNB;
@@ -56,6 +71,50 @@ void Params::setparams(char *config_file) {
 	return;
 }
 
+/**
+ * FUNCTION NAME: setoption
+ *
+ * DESCRIPTION: Set one of the optional parameters of the test case.
+ * 				Unknown keys are ignored.
+ */
+void Params::setoption(char *key, char *value) {
+	if ( 0 == strcmp(key, "EN_BUFFSIZE") ) {
+		EN_BUFFSIZE = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "DELAY_MODEL") ) {
+		if ( 0 == strcmp(value, "FIXED") ) {
+			DELAY_MODEL = FIXED_DELAY;
+		}
+		else if ( 0 == strcmp(value, "UNIFORM") ) {
+			DELAY_MODEL = UNIFORM_DELAY;
+		}
+		else if ( 0 == strcmp(value, "PARETO") ) {
+			DELAY_MODEL = PARETO_DELAY;
+		}
+		else {
+			DELAY_MODEL = NO_DELAY;
+		}
+	}
+	else if ( 0 == strcmp(key, "DELAY_MIN") ) {
+		DELAY_MIN = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "DELAY_MAX") ) {
+		DELAY_MAX = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "DELAY_ALPHA") ) {
+		DELAY_ALPHA = atof(value);
+	}
+	else if ( 0 == strcmp(key, "MP1_PROTOCOL") ) {
+		MP1_PROTOCOL = ( 0 == strcmp(value, "SWIM") ) ? SWIM_PROTOCOL : GOSSIP_PROTOCOL;
+	}
+	else if ( 0 == strcmp(key, "WIRE_FORMAT") ) {
+		WIRE_FORMAT = ( 0 == strcmp(value, "BINARY") ) ? BINARY_WIRE : TEXT_WIRE;
+	}
+	else if ( 0 == strcmp(key, "VNODES") ) {
+		VNODES = max(1, atoi(value));
+	}
+}
+
 /**
  * FUNCTION NAME: getcurrtime
  *
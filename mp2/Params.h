@@ -11,6 +11,9 @@
 #include "Params.h"
 #include "Member.h"
 
+enum delayTYPE { NO_DELAY, FIXED_DELAY, UNIFORM_DELAY, PARETO_DELAY };
+enum protocolTYPE { GOSSIP_PROTOCOL, SWIM_PROTOCOL };
+enum wireTYPE { TEXT_WIRE, BINARY_WIRE };
 enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
 
 /**
@@ -31,9 +34,18 @@ public:
 	int globaltime;
 	int allNodesJoined;
 	short PORTNUM;
+	int EN_BUFFSIZE;			// max in-flight messages per EmulNet, 0 means unbounded
+	int DELAY_MODEL;			// delayTYPE of the emulated network latency
+	int DELAY_MIN;				// minimum extra delivery delay in ticks
+	int DELAY_MAX;				// maximum extra delivery delay in ticks
+	double DELAY_ALPHA;			// shape of the long tailed (Pareto) delay
+	int MP1_PROTOCOL;			// protocolTYPE of the membership failure detector
+	int WIRE_FORMAT;			// wireTYPE used to encode KV store messages
+	int VNODES;					// virtual nodes per member on the consistent hashing ring
 	int CRUDTEST;
 	Params();
 	void setparams(char *);
+	void setoption(char *key, char *value);
 	int getcurrtime();
 };
 
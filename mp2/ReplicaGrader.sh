@@ -0,0 +1,55 @@
+#!/bin/bash
+
+#################################################
+# FILE NAME: ReplicaGrader.sh
+#
+# DESCRIPTION: Checks that every key is back on all of its
+#			   replicas after the node failures of a test
+#
+# RUN PROCEDURE:
+# $ chmod +x ReplicaGrader.sh
+# $ ./ReplicaGrader.sh [runs]
+#################################################
+
+###
+# Global variables
+###
+SUCCESS=0
+FAILURE=-1
+RUNS=${1:-3}
+REPLICA_CHECK="REPLICA CHECK:"
+STATUS="${SUCCESS}"
+
+make clean > /dev/null 2>&1
+make > /dev/null 2>&1
+if [ $? -ne "${SUCCESS}" ]
+then
+	echo "COMPILATION ERROR !!!"
+	exit 1
+fi
+
+for test in read update
+do
+	for run in `seq ${RUNS}`
+	do
+		./Application ./testcases/${test}.conf > /dev/null 2>&1
+		# REPLICA CHECK: <keys on all replicas> of <keys> keys on all replicas
+		result=`grep "${REPLICA_CHECK}" dbg.log | sed "s/.*${REPLICA_CHECK} //"`
+		held=`echo ${result} | cut -d" " -f1`
+		total=`echo ${result} | cut -d" " -f3`
+		echo "${test} run ${run}: ${held} of ${total} keys on all replicas"
+		if [ -z "${held}" ] || [ "${held}" -ne "${total}" ]
+		then
+			STATUS="${FAILURE}"
+		fi
+		sleep 1
+	done
+done
+
+if [ "${STATUS}" -eq "${SUCCESS}" ]
+then
+	echo "REPLICA TEST PASSED"
+else
+	echo "REPLICA TEST FAILED"
+	exit 1
+fi
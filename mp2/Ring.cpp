@@ -0,0 +1,177 @@
+/**********************************
+ * FILE NAME: Ring.cpp
+ *
+ * DESCRIPTION: Ring class definition
+ **********************************/
+
+#include "Ring.h"
+
+map<uint64_t, vector<weak_ptr<const Ring>>> Ring::pool;
+
+/**
+ * constructor
+ */
+Ring::Ring(vector<Node> nodes, uint64_t contentHash): nodes(std::move(nodes)), hashes(hashCodes(this->nodes)),
+	members(memberKeys(this->nodes)), memberCount(members.size()), contentHash(contentHash) {}
+
+/**
+ * FUNCTION NAME: intern
+ *
+ * DESCRIPTION: Returns the live snapshot holding exactly these nodes, or creates one.
+ * 				The nodes must already be sorted by hash code.
+ */
+shared_ptr<const Ring> Ring::intern(vector<Node> nodes) {
+	uint64_t hash = hashOf(nodes);
+	vector<weak_ptr<const Ring>> &bucket = pool[hash];
+	shared_ptr<const Ring> ring;
+
+	// reuse a matching snapshot
+	for ( size_t i = 0; i < bucket.size(); i++ ) {
+		shared_ptr<const Ring> candidate = bucket[i].lock();
+		if ( candidate && candidate->sameNodes(nodes) ) {
+			return candidate;
+		}
+	}
+
+	ring = shared_ptr<const Ring>(new Ring(std::move(nodes), hash), release);
+	bucket.push_back(ring);
+	return ring;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Deleter of the interned snapshots: takes the snapshot out of the pool,
+ * 				and its bucket too once empty, before deleting it
+ */
+void Ring::release(const Ring *ring) {
+	map<uint64_t, vector<weak_ptr<const Ring>>>::iterator bucket = pool.find(ring->contentHash);
+	if ( bucket != pool.end() ) {
+		// nobody holds the snapshot being released anymore, so it is expired
+		vector<weak_ptr<const Ring>> &refs = bucket->second;
+		for ( size_t i = 0; i < refs.size(); ) {
+			if ( refs[i].expired() ) {
+				refs[i] = refs.back();
+				refs.pop_back();
+				continue;
+			}
+			i++;
+		}
+		if ( refs.empty() ) {
+			pool.erase(bucket);
+		}
+	}
+	delete ring;
+}
+
+/**
+ * FUNCTION NAME: successor
+ *
+ * DESCRIPTION: Returns the index of the first node whose hash code is at or after pos,
+ * 				wrapping around to the first node. The ring must not be empty.
+ */
+size_t Ring::successor(uint64_t pos) const {
+	vector<uint64_t>::const_iterator it = lower_bound(hashes.begin(), hashes.end(), pos);
+	if ( it == hashes.end() ) {
+		return 0;
+	}
+	return it - hashes.begin();
+}
+
+/**
+ * FUNCTION NAME: hasNode
+ *
+ * DESCRIPTION: Returns whether the ring holds this virtual node: same hash code and address
+ */
+bool Ring::hasNode(const Node& node) const {
+	vector<uint64_t>::const_iterator it = lower_bound(hashes.begin(), hashes.end(), node.nodeHashCode);
+	for ( ; it != hashes.end() && *it == node.nodeHashCode; it++ ) {
+		if ( memcmp(nodes[it - hashes.begin()].nodeAddress.addr, node.nodeAddress.addr, sizeof(node.nodeAddress.addr)) == 0 ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: hasMember
+ *
+ * DESCRIPTION: Returns whether addr has a node on the ring
+ */
+bool Ring::hasMember(const Address& addr) const {
+	return binary_search(members.begin(), members.end(), addressKey(addr));
+}
+
+/**
+ * FUNCTION NAME: hashCodes
+ *
+ * DESCRIPTION: Returns the hash codes of the given nodes, in order
+ */
+vector<uint64_t> Ring::hashCodes(const vector<Node>& nodes) {
+	vector<uint64_t> hashes;
+	hashes.reserve(nodes.size());
+	for ( size_t i = 0; i < nodes.size(); i++ ) {
+		hashes.push_back(nodes[i].nodeHashCode);
+	}
+	return hashes;
+}
+
+/**
+ * FUNCTION NAME: addressKey
+ *
+ * DESCRIPTION: Packs the 6 bytes of an address into an integer, equal for equal addresses
+ */
+uint64_t Ring::addressKey(const Address& addr) {
+	uint64_t key = 0;
+	memcpy(&key, addr.addr, sizeof(addr.addr));
+	return key;
+}
+
+/**
+ * FUNCTION NAME: memberKeys
+ *
+ * DESCRIPTION: Returns the distinct addresses among the given nodes as sorted addressKey values
+ */
+vector<uint64_t> Ring::memberKeys(const vector<Node>& nodes) {
+	vector<uint64_t> keys;
+	keys.reserve(nodes.size());
+	for ( size_t i = 0; i < nodes.size(); i++ ) {
+		keys.push_back(addressKey(nodes[i].nodeAddress));
+	}
+	sort(keys.begin(), keys.end());
+	keys.erase(unique(keys.begin(), keys.end()), keys.end());
+	return keys;
+}
+
+/**
+ * FUNCTION NAME: hashOf
+ *
+ * DESCRIPTION: FNV-1a hash of the addresses on the ring
+ */
+uint64_t Ring::hashOf(const vector<Node>& nodes) {
+	uint64_t hash = 14695981039346656037ULL;
+	for ( size_t i = 0; i < nodes.size(); i++ ) {
+		for ( size_t j = 0; j < sizeof(nodes[i].nodeAddress.addr); j++ ) {
+			hash ^= (unsigned char)nodes[i].nodeAddress.addr[j];
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+/**
+ * FUNCTION NAME: sameNodes
+ *
+ * DESCRIPTION: Returns true if this snapshot holds exactly the given nodes, in order
+ */
+bool Ring::sameNodes(const vector<Node>& other) const {
+	if ( nodes.size() != other.size() ) {
+		return false;
+	}
+	for ( size_t i = 0; i < nodes.size(); i++ ) {
+		if ( memcmp(nodes[i].nodeAddress.addr, other[i].nodeAddress.addr, sizeof(nodes[i].nodeAddress.addr)) != 0 ) {
+			return false;
+		}
+	}
+	return true;
+}
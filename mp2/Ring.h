@@ -0,0 +1,157 @@
+/**********************************
+ * FILE NAME: Ring.h
+ *
+ * DESCRIPTION: Header file of the Ring class
+ **********************************/
+
+#ifndef RING_H_
+#define RING_H_
+
+#include "stdincludes.h"
+#include "Node.h"
+#include "common.h"
+
+// The RF nodes holding a key, primary first
+typedef array<Node, RF> ReplicaSet;
+
+/**
+ * CLASS NAME: Ring
+ *
+ * DESCRIPTION: Immutable snapshot of the consistent hashing ring: the virtual nodes of
+ * 				every member, sorted by hash code.
+ * 				Snapshots are interned by content, so all nodes whose membership views
+ * 				agree share a single copy. A view change builds a new snapshot.
+ */
+class Ring {
+public:
+	// Virtual nodes on the ring, sorted by hash code
+	const vector<Node> nodes;
+	// Hash codes of the nodes, in the same order, for binary search
+	const vector<uint64_t> hashes;
+	// Distinct member addresses on the ring as addressKey values, sorted for binary search
+	const vector<uint64_t> members;
+	// Number of distinct members (physical nodes) on the ring
+	const size_t memberCount;
+	// Hash of the addresses on the ring, used to intern snapshots
+	const uint64_t contentHash;
+	static shared_ptr<const Ring> intern(vector<Node> nodes);
+	size_t size() const { return nodes.size(); }
+	const Node& at(size_t i) const { return nodes.at(i); }
+	size_t successor(uint64_t pos) const;
+	bool hasMember(const Address& addr) const;
+	template <size_t N> array<Node, N> replicasOf(uint64_t pos) const;
+	template <size_t N> pair<uint64_t, uint64_t> arcReaching(size_t i) const;
+	template <size_t N> void changedArcs(const Ring& other, vector<pair<uint64_t, uint64_t>>& arcs) const;
+	bool hasNode(const Node& node) const;
+
+private:
+	// Live snapshots by content hash
+	static map<uint64_t, vector<weak_ptr<const Ring>>> pool;
+	Ring(vector<Node> nodes, uint64_t contentHash);
+	static void release(const Ring *ring);
+	static uint64_t hashOf(const vector<Node>& nodes);
+	static vector<uint64_t> hashCodes(const vector<Node>& nodes);
+	static uint64_t addressKey(const Address& addr);
+	static vector<uint64_t> memberKeys(const vector<Node>& nodes);
+	bool sameNodes(const vector<Node>& other) const;
+};
+
+/**
+ * FUNCTION NAME: replicasOf
+ *
+ * DESCRIPTION: Returns the N members holding key position pos, primary first: the
+ * 				members of the virtual nodes met walking the ring from pos, each taken
+ * 				once. Slots stay null nodes if the ring has fewer than N members.
+ */
+template <size_t N>
+array<Node, N> Ring::replicasOf(uint64_t pos) const {
+	array<Node, N> replicas;
+	size_t found = 0, i, j, k;
+	if ( nodes.empty() ) {
+		return replicas;
+	}
+	k = successor(pos);
+	for ( i = 0; i < nodes.size() && found < N; i++, k = (k + 1) % nodes.size() ) {
+		// skip virtual nodes of members already chosen
+		for ( j = 0; j < found; j++ ) {
+			if ( memcmp(replicas[j].nodeAddress.addr, nodes[k].nodeAddress.addr, sizeof(nodes[k].nodeAddress.addr)) == 0 ) {
+				break;
+			}
+		}
+		if ( j == found ) {
+			replicas[found++] = nodes[k];
+		}
+	}
+	return replicas;
+}
+
+/**
+ * FUNCTION NAME: arcReaching
+ *
+ * DESCRIPTION: Returns the ring range (start, end] of the key positions whose walk for
+ * 				N members reaches node i: the walk back from the node until N distinct
+ * 				members are met. start == end stands for the whole ring.
+ */
+template <size_t N>
+pair<uint64_t, uint64_t> Ring::arcReaching(size_t i) const {
+	array<Node, N> seen;
+	size_t found = 0, j, k, step;
+	for ( step = 1, k = i; step < nodes.size(); step++ ) {
+		k = (k + nodes.size() - 1) % nodes.size();
+		for ( j = 0; j < found; j++ ) {
+			if ( memcmp(seen[j].nodeAddress.addr, nodes[k].nodeAddress.addr, sizeof(nodes[k].nodeAddress.addr)) == 0 ) {
+				break;
+			}
+		}
+		if ( j == found ) {
+			seen[found++] = nodes[k];
+			// keys at or before this node find N members before node i
+			if ( found == N ) {
+				return make_pair(hashes[k], hashes[i]);
+			}
+		}
+	}
+	return make_pair(hashes[i], hashes[i]);
+}
+
+/**
+ * FUNCTION NAME: changedArcs
+ *
+ * DESCRIPTION: Appends to arcs the ring ranges where the N replicas of a key may differ
+ * 				between this ring and other: the ranges reaching a node that is on only
+ * 				one of the two rings. Keys outside every range keep their replicas.
+ */
+template <size_t N>
+void Ring::changedArcs(const Ring& other, vector<pair<uint64_t, uint64_t>>& arcs) const {
+	size_t i;
+	// nodes that left
+	for ( i = 0; i < nodes.size(); i++ ) {
+		if ( !other.hasNode(nodes[i]) ) {
+			arcs.push_back(arcReaching<N>(i));
+		}
+	}
+	// nodes that joined
+	for ( i = 0; i < other.nodes.size(); i++ ) {
+		if ( !hasNode(other.nodes[i]) ) {
+			arcs.push_back(other.arcReaching<N>(i));
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: replicaRole
+ *
+ * DESCRIPTION: Returns the replica type of addr in a replica set, its index in the set,
+ * 				or UNKNOWN if it does not hold the key
+ */
+template <size_t N>
+ReplicaType replicaRole(const array<Node, N>& replicas, const Address& addr) {
+	for ( size_t i = 0; i < N; i++ ) {
+		if ( memcmp(replicas[i].nodeAddress.addr, addr.addr, sizeof(addr.addr)) == 0 ) {
+			return static_cast<ReplicaType>(i);
+		}
+	}
+	return UNKNOWN;
+}
+
+#endif /* RING_H_ */
@@ -7,9 +7,16 @@
 // Transaction Id
 static int g_transID = 0;
 
-// message types, reply is the message from node to coordinator
-enum MessageType {CREATE, READ, UPDATE, DELETE, REPLY, READREPLY};
-// enum of replica types
-enum ReplicaType {PRIMARY, SECONDARY, TERTIARY, UNKNOWN};
+// Replication factor: number of nodes holding each key, set with make RF=<n>
+#ifndef RF
+#define RF 3
+#endif
+
+// message types, reply is the message from node to coordinator,
+// bulk carries many entries from one replica to another (binary wire format only)
+enum MessageType {CREATE, READ, UPDATE, DELETE, REPLY, READREPLY, BULK};
+// enum of replica types, the node at index i of a key's replica set has type i
+enum ReplicaType : unsigned char {PRIMARY, SECONDARY, TERTIARY, UNKNOWN = 0xFF};
+static_assert(RF >= 1 && RF < UNKNOWN, "replication factor out of range");
 
 #endif
@@ -10,7 +10,6 @@
 /*
  * Macros
  */
-#define RING_SIZE 512
 #define FAILURE -1
 #define SUCCESS 0
 
@@ -21,6 +20,7 @@
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 #include <time.h>
 #include <stdarg.h>
@@ -30,8 +30,13 @@
 #include <signal.h>
 #include <iostream>
 #include <vector>
+#include <array>
 #include <map>
+#include <unordered_map>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <charconv>
 #include <algorithm>
 #include <queue>
 #include <fstream>